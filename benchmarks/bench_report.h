@@ -0,0 +1,36 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef BENCHMARKS_BENCH_REPORT_H
+#define BENCHMARKS_BENCH_REPORT_H
+
+#include <cstdio>
+
+#include "sst/clap_juce_shim/histogram.h"
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+namespace sst::clap_juce_shim::bench
+{
+inline void report(const char *what, const Histogram &h, const char *unit = "ms")
+{
+    std::printf("  %-30s n=%-7llu p50=%9.3f p90=%9.3f p99=%9.3f max=%9.3f %s\n", what,
+                (unsigned long long)h.count(), h.percentile(50), h.percentile(90),
+                h.percentile(99), h.max(), unit);
+}
+
+inline double megabytes(uint64_t bytes) { return (double)bytes / (1024.0 * 1024.0); }
+} // namespace sst::clap_juce_shim::bench
+
+#endif // BENCHMARKS_BENCH_REPORT_H
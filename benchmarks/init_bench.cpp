@@ -0,0 +1,80 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+/*
+ * What JUCE initialisation costs each host tick. onTimer and onPosixFd used to build
+ * a ScopedJuceInitialiser_GUI around every call; now the library holds one while an
+ * editor is open and the tick only pumps. Both are timed on the same open editor,
+ * the old way by wrapping each onTimer in an initialiser as the shim did. Run as
+ *
+ *     clap_juce_shim_init_bench [ticks]
+ */
+
+#include "mock_clap_host.h"
+#include "bench_report.h"
+
+#include <cstdlib>
+#include <functional>
+
+namespace
+{
+using namespace sst::clap_juce_shim;
+using test::MockClapHost;
+
+void timeTicks(Histogram &us, int ticks, const std::function<void()> &tick)
+{
+    for (int i = 0; i < ticks; ++i)
+    {
+        auto start = MockClapHost::nowMs();
+        tick();
+        us.record((MockClapHost::nowMs() - start) * 1000.0);
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    auto ticks = argc > 1 ? std::max(std::atoi(argv[1]), 10) : 20000;
+
+    MockClapHost host;
+    auto inst = host.load();
+    if (!inst->shim->guiCreate(CLAP_WINDOW_API_X11, false) || host.timers.empty())
+    {
+        std::printf("Could not open an editor on the mock host\n");
+        return 1;
+    }
+    host.runFor(200);
+    auto id = host.timers.front().id;
+
+    std::printf("init: %d onTimer calls with one editor open\n", ticks);
+
+    // Alternate so drift in the machine hits both the same
+    Histogram before, after;
+    for (int round = 0; round < 10; ++round)
+    {
+        timeTicks(before, ticks / 10, [&]() {
+            juce::ScopedJuceInitialiser_GUI perTick;
+            inst->shim->onTimer(id);
+        });
+        timeTicks(after, ticks / 10, [&]() { inst->shim->onTimer(id); });
+    }
+
+    bench::report("before: initialiser per tick", before, "us");
+    bench::report("after: initialised once", after, "us");
+    std::printf("  %.3f us saved per tick at p50\n",
+                before.percentile(50) - after.percentile(50));
+
+    inst->shim->guiDestroy();
+    return 0;
+}
@@ -0,0 +1,506 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+/*
+ * Drives the shim through the mock clap host the way a linux host would, timing the
+ * gui lifecycle calls and the pump, and soaking many instances while watching the
+ * resident size. Run as
+ *
+ *     clap_juce_shim_bench [all|lifecycle|pump|getsize|wrappers|render|soak]
+ *                          [instances] [rounds]
+ *
+ * With a display, such as Xvfb's, the editors are parented to real x11 windows.
+ * Without one the guiSetParent step is skipped and nothing reaches the screen, so
+ * the lifecycle phase refuses to report and the wrappers phase has no paints to
+ * count. Exits non zero if the soak leaks shims, editors, timers or fds.
+ */
+
+#include "mock_clap_host.h"
+#include "bench_report.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <thread>
+
+#include <X11/Xlib.h>
+
+namespace
+{
+using namespace sst::clap_juce_shim;
+using test::MockClapHost;
+using Instance = MockClapHost::Instance;
+
+// A modest editor: a painted background under a grid of buttons
+struct BenchEditor : juce::Component
+{
+    BenchEditor()
+    {
+        for (int i = 0; i < 32; ++i)
+        {
+            buttons.push_back(std::make_unique<juce::TextButton>("Button " + juce::String(i)));
+            addAndMakeVisible(*buttons.back());
+        }
+        setSize(900, 600);
+    }
+
+    void paint(juce::Graphics &g) override
+    {
+        g.fillAll(juce::Colours::darkslategrey);
+        g.setColour(juce::Colours::white);
+        g.drawText("clap juce shim bench", getLocalBounds().removeFromTop(40),
+                   juce::Justification::centred);
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds().reduced(10).withTrimmedTop(40);
+        auto w = r.getWidth() / 8, h = r.getHeight() / 4;
+        for (size_t i = 0; i < buttons.size(); ++i)
+            buttons[i]->setBounds(r.getX() + (int)(i % 8) * w, r.getY() + (int)(i / 8) * h,
+                                  w - 4, h - 4);
+    }
+
+    std::vector<std::unique_ptr<juce::TextButton>> buttons;
+};
+
+// The host side windows editors get parented to, one per open editor
+struct ParentWindows
+{
+    ParentWindows() : display(XOpenDisplay(nullptr)) {}
+    ~ParentWindows()
+    {
+        while (!windows.empty())
+            release(&windows.front());
+        if (display)
+            XCloseDisplay(display);
+    }
+
+    bool available() const { return display != nullptr; }
+
+    const clap_window_t *make()
+    {
+        if (!display)
+            return nullptr;
+        auto x = XCreateSimpleWindow(display, DefaultRootWindow(display), 0, 0, 900, 600, 0, 0, 0);
+        XMapWindow(display, x);
+        XFlush(display);
+
+        auto &w = windows.emplace_back();
+        w.api = CLAP_WINDOW_API_X11;
+        w.x11 = x;
+        return &w;
+    }
+
+    void release(const clap_window_t *w)
+    {
+        if (!w)
+            return;
+        XDestroyWindow(display, (Window)w->x11);
+        XFlush(display);
+        windows.remove_if([w](auto &x) { return &x == w; });
+    }
+
+  private:
+    Display *display{nullptr};
+    std::list<clap_window_t> windows;
+};
+
+struct Options
+{
+    int instances{8};
+    int rounds{40};
+};
+
+// The editor the last loaded instance created, for phases which poke at it
+BenchEditor *lastEditor{nullptr};
+
+std::unique_ptr<Instance> loadInstance(MockClapHost &host)
+{
+    auto res = host.load();
+    res->makeEditor = []() {
+        auto ed = std::make_unique<BenchEditor>();
+        lastEditor = ed.get();
+        return ed;
+    };
+    return res;
+}
+
+// guiCreate, guiSetParent if there is a display, then guiShow. Returns the parent.
+const clap_window_t *openEditor(Instance &i, ParentWindows &parents)
+{
+    i.shim->guiCreate(CLAP_WINDOW_API_X11, false);
+    auto *w = parents.make();
+    if (w)
+        i.shim->guiSetParent(w);
+    i.shim->guiShow();
+    return w;
+}
+
+void closeEditor(Instance &i, ParentWindows &parents, const clap_window_t *w)
+{
+    i.shim->guiDestroy();
+    parents.release(w);
+}
+
+bool lifecycle(MockClapHost &host, ParentWindows &parents, const Options &o)
+{
+    auto cycles = o.rounds * 4;
+    std::printf("lifecycle: %d open and close cycles of one instance\n", cycles);
+    if (!parents.available())
+    {
+        // Without guiSetParent the numbers would not be a host's
+        std::printf("  needs an x11 display, run under Xvfb\n");
+        return false;
+    }
+
+    ClapJuceShim::resetLifecycleTimings();
+    Histogram openMs, closeMs;
+    auto inst = loadInstance(host);
+    for (int i = 0; i < cycles; ++i)
+    {
+        auto start = MockClapHost::nowMs();
+        auto *w = openEditor(*inst, parents);
+        openMs.record(MockClapHost::nowMs() - start);
+
+        host.runFor(5);
+
+        start = MockClapHost::nowMs();
+        closeEditor(*inst, parents, w);
+        closeMs.record(MockClapHost::nowMs() - start);
+    }
+
+    auto st = ClapJuceShim::getLifecycleStats();
+    bench::report("guiCreate", st.guiCreateMilliseconds);
+    bench::report("guiSetParent", st.guiSetParentMilliseconds);
+    bench::report("guiShow", st.guiShowMilliseconds);
+    bench::report("guiDestroy", st.guiDestroyMilliseconds);
+    bench::report("create to show", openMs);
+    bench::report("destroy and unparent", closeMs);
+    return true;
+}
+
+bool pump(MockClapHost &host, ParentWindows &parents, const Options &)
+{
+    std::printf("pump: cost of each host tick with one editor open\n");
+
+    auto inst = loadInstance(host);
+    auto *w = openEditor(*inst, parents);
+    host.runFor(200);
+
+    // Messages costing around 20us each, posted as a busy editor's worker would
+    auto work = []() {
+        auto until = MockClapHost::nowMs() + 0.02;
+        while (MockClapHost::nowMs() < until)
+            ;
+    };
+
+    auto run = [&](const char *label, int postsPerMillisecond) {
+        host.timerCallbackMilliseconds.reset();
+        host.fdCallbackMilliseconds.reset();
+        auto before = ClapJuceShim::getPumpStats();
+
+        std::atomic<bool> stop{false};
+        std::thread poster;
+        if (postsPerMillisecond > 0)
+        {
+            poster = std::thread([&]() {
+                while (!stop)
+                {
+                    for (int i = 0; i < postsPerMillisecond; ++i)
+                        juce::MessageManager::callAsync(work);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+        }
+        host.runFor(2000);
+        stop = true;
+        if (poster.joinable())
+            poster.join();
+        host.runFor(100); // drain what the poster left
+
+        auto after = ClapJuceShim::getPumpStats();
+        auto ticks = std::max(after.ticks - before.ticks, (uint64_t)1);
+        std::printf("  %s: %llu ticks, %.1f dispatches and %.3f ms per tick, %llu over budget, "
+                    "idle timer at %u Hz\n",
+                    label, (unsigned long long)ticks,
+                    (double)(after.dispatches - before.dispatches) / ticks,
+                    (after.pumpMilliseconds - before.pumpMilliseconds) / ticks,
+                    (unsigned long long)(after.budgetExceeded - before.budgetExceeded),
+                    inst->shim->getIdleTimerHz());
+        bench::report("onTimer", host.timerCallbackMilliseconds);
+        bench::report("onPosixFd", host.fdCallbackMilliseconds);
+    };
+
+    run("idle", 0);
+    run("busy", 2);
+    run("flooded", 50);
+
+    closeEditor(*inst, parents, w);
+    return true;
+}
+
+/*
+ * guiGetSize hammered from another thread, as hosts do during layout, while the
+ * main thread drags the size around and pumps. The message manager lock run is what
+ * each query cost before the size was published.
+ */
+bool getSize(MockClapHost &host, ParentWindows &parents, const Options &)
+{
+    std::printf("getsize: size queries from another thread during a resize drag\n");
+
+    auto inst = loadInstance(host);
+    auto *w = openEditor(*inst, parents);
+    host.runFor(200);
+
+    auto run = [&](const char *label, const std::function<void()> &query) {
+        host.timerCallbackMilliseconds.reset();
+        std::atomic<bool> stop{false};
+        uint64_t calls{0};
+        Histogram callMicroseconds; // only the querying thread touches this until it joins
+
+        std::thread querier;
+        if (query)
+        {
+            querier = std::thread([&]() {
+                while (!stop)
+                {
+                    // Time a sample only, so the clock does not dominate
+                    if ((calls++ & 63) == 0)
+                    {
+                        auto start = MockClapHost::nowMs();
+                        query();
+                        callMicroseconds.record((MockClapHost::nowMs() - start) * 1000.0);
+                    }
+                    else
+                    {
+                        query();
+                    }
+                }
+            });
+        }
+
+        auto start = MockClapHost::nowMs();
+        for (int i = 0; i < 100; ++i)
+        {
+            inst->shim->guiSetSize(800 + (i % 20) * 10, 500 + (i % 10) * 10);
+            host.runFor(20);
+        }
+        auto secs = (MockClapHost::nowMs() - start) / 1000.0;
+        stop = true;
+        if (querier.joinable())
+            querier.join();
+
+        std::printf("  %s: %.0f queries per second\n", label, calls / secs);
+        if (query)
+            bench::report("query", callMicroseconds, "us");
+        bench::report("onTimer", host.timerCallbackMilliseconds);
+    };
+
+    run("no queries", nullptr);
+    run("guiGetSize", [&]() {
+        uint32_t qw{0}, qh{0};
+        inst->shim->guiGetSize(&qw, &qh);
+    });
+    run("message manager lock", []() { const juce::MessageManagerLock lock; });
+
+    closeEditor(*inst, parents, w);
+    return true;
+}
+
+/*
+ * Full editor repaints with the editor transparent and then opaque. Opaque, JUCE
+ * skips the wrappers' paint() altogether, and every pixel should count as skipped.
+ */
+bool wrappers(MockClapHost &host, ParentWindows &parents, const Options &o)
+{
+    std::printf("wrappers: background pixels the wrappers fill under repaints\n");
+
+    auto inst = loadInstance(host);
+    auto *w = openEditor(*inst, parents);
+    auto *ed = lastEditor;
+    host.runFor(200);
+    inst->shim->setInstrumentationEnabled(true);
+
+    auto run = [&](const char *label, bool opaque) {
+        ed->setOpaque(opaque);
+        host.runFor(50);
+        inst->shim->resetInstrumentation();
+        for (int i = 0; i < o.rounds * 5; ++i)
+        {
+            ed->repaint();
+            host.runFor(16);
+        }
+
+        auto st = inst->shim->getInstrumentation();
+        auto total = std::max(st.wrapperPixelsFilled + st.wrapperPixelsSkipped, (uint64_t)1);
+        std::printf("  %s: %llu pixels filled, %llu skipped, %.1f%% skipped\n", label,
+                    (unsigned long long)st.wrapperPixelsFilled,
+                    (unsigned long long)st.wrapperPixelsSkipped,
+                    100.0 * st.wrapperPixelsSkipped / total);
+        bench::report("frame", st.frameMilliseconds);
+        bench::report("dirty", st.dirtyPixels, "px");
+    };
+
+    run("transparent editor", false);
+    run("opaque editor", true);
+
+    inst->shim->setInstrumentationEnabled(false);
+    closeEditor(*inst, parents, w);
+    return true;
+}
+
+bool samePixels(const juce::Image &a, const juce::Image &b)
+{
+    if (a.getBounds() != b.getBounds())
+        return false;
+    for (int y = 0; y < a.getHeight(); ++y)
+        for (int x = 0; x < a.getWidth(); ++x)
+            if (a.getPixelAt(x, y) != b.getPixelAt(x, y))
+                return false;
+    return true;
+}
+
+/*
+ * renderToImage at a few sizes and scales, which needs no display. Every render of
+ * a size has to match the first pixel for pixel, as golden image tests rely on.
+ */
+bool render(MockClapHost &host, ParentWindows &parents, const Options &o)
+{
+    std::printf("render: offscreen renders of the editor\n");
+
+    auto inst = loadInstance(host);
+    auto *w = openEditor(*inst, parents);
+    host.runFor(50);
+
+    auto run = [&](const char *label, int width, int height, double scale) {
+        Histogram ms;
+        juce::Image first;
+        for (int i = 0; i < o.rounds; ++i)
+        {
+            auto start = MockClapHost::nowMs();
+            auto img = inst->shim->renderToImage(width, height, scale);
+            ms.record(MockClapHost::nowMs() - start);
+            if (!img.isValid())
+            {
+                std::printf("  %s: no image\n", label);
+                return false;
+            }
+            if (i == 0)
+            {
+                first = img.createCopy(); // in case renders share pixel data
+            }
+            else if (!samePixels(first, img))
+            {
+                std::printf("  %s: render %d differs from the first\n", label, i);
+                return false;
+            }
+        }
+        bench::report(label, ms);
+        return true;
+    };
+
+    auto ok = run("current size", 0, 0, 1.0);
+    ok = run("current size at 2x", 0, 0, 2.0) && ok;
+    ok = run("1800x1200", 1800, 1200, 1.0) && ok;
+
+    closeEditor(*inst, parents, w);
+    return ok;
+}
+
+bool soak(MockClapHost &host, ParentWindows &parents, const Options &o)
+{
+    std::printf("soak: %d rounds of loading, opening, closing and unloading %d instances\n",
+                o.rounds, o.instances);
+
+    uint64_t firstRss{0}, lastRss{0}, peakRss{0};
+    auto every = std::max(o.rounds / 10, 1);
+    for (int r = 0; r < o.rounds; ++r)
+    {
+        std::vector<std::unique_ptr<Instance>> insts;
+        std::vector<const clap_window_t *> windows;
+        for (int i = 0; i < o.instances; ++i)
+        {
+            insts.push_back(loadInstance(host));
+            windows.push_back(openEditor(*insts.back(), parents));
+        }
+        host.runFor(20);
+        for (size_t i = 0; i < insts.size(); ++i)
+            closeEditor(*insts[i], parents, windows[i]);
+        insts.clear();
+
+        lastRss = ClapJuceShim::getLifecycleStats().residentBytes;
+        peakRss = std::max(peakRss, lastRss);
+        if (r == 0)
+            firstRss = lastRss;
+        if (r % every == 0 || r == o.rounds - 1)
+            std::printf("  round %5d  rss %8.1f MB\n", r, bench::megabytes(lastRss));
+    }
+
+    auto st = ClapJuceShim::getLifecycleStats();
+    std::printf("  rss after the first round %.1f MB, at the end %.1f MB, peak %.1f MB\n",
+                bench::megabytes(firstRss), bench::megabytes(lastRss),
+                bench::megabytes(peakRss));
+    std::printf("  %llu shims and %llu editors created, %u and %u still alive\n",
+                (unsigned long long)st.shimsCreated, (unsigned long long)st.editorsCreated,
+                st.liveShims, st.liveEditors);
+    std::printf("  host: %zu timers and %zu fds registered, %llu and %llu leaked\n",
+                host.timers.size(), host.fds.size(), (unsigned long long)host.leakedTimers,
+                (unsigned long long)host.leakedFds);
+
+    auto ok = st.liveShims == 0 && st.liveEditors == 0 && host.timers.empty() &&
+              host.fds.empty() && host.leakedTimers == 0 && host.leakedFds == 0;
+    if (!ok)
+        std::printf("  LEAK\n");
+    return ok;
+}
+
+using Phase = bool (*)(MockClapHost &, ParentWindows &, const Options &);
+const std::pair<const char *, Phase> phases[] = {
+    {"lifecycle", lifecycle},
+    {"pump", pump},
+    {"getsize", getSize},
+    {"wrappers", wrappers},
+    {"render", render},
+    {"soak", soak},
+};
+} // namespace
+
+int main(int argc, char **argv)
+{
+    auto which = argc > 1 ? argv[1] : "all";
+    auto o = Options();
+    if (argc > 2)
+        o.instances = std::max(std::atoi(argv[2]), 1);
+    if (argc > 3)
+        o.rounds = std::max(std::atoi(argv[3]), 1);
+
+    MockClapHost host;
+    ParentWindows parents;
+    if (!parents.available())
+        std::printf("No x11 display, so guiSetParent is skipped\n");
+
+    bool ok{true}, ran{false};
+    for (auto &[name, phase] : phases)
+    {
+        if (std::strcmp(which, "all") != 0 && std::strcmp(which, name) != 0)
+            continue;
+        ok = phase(host, parents, o) && ok;
+        ran = true;
+    }
+    if (!ran)
+        std::printf("Unknown phase %s\n", which);
+    return ok && ran ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+/*
+ * Builds host context menus of about a thousand entries nested five submenus deep,
+ * straight from the host, from the cache, and merged over a multi selection, timing
+ * each build and counting its allocations. Run as
+ *
+ *     clap_juce_shim_menu_bench [rounds]
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+
+#include "sst/clap_juce_shim/menu_helper.h"
+#include "clap/ext/context-menu.h"
+#include "bench_report.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Only allocations made while this is set are counted
+bool countAllocations{false};
+std::atomic<uint64_t> allocations{0};
+
+double nowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+void *operator new(size_t n)
+{
+    if (countAllocations)
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t n) { return ::operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace
+{
+using namespace sst::clap_juce_shim;
+
+/*
+ * A host whose menu is two submenus per level down to five levels, each holding 16
+ * entries, every fourth a check entry: 1008 entries in 63 menus. The labels are made
+ * up front so populate itself allocates nothing.
+ */
+struct SyntheticHost
+{
+    static constexpr int depth{5}, fanout{2}, entriesPerMenu{16};
+    static constexpr int menus{63}; // 1 + 2 + 4 + 8 + 16 + 32
+
+    clap_host_t host{};
+    clap_host_context_menu_t ext{};
+    std::vector<std::string> labels;
+    uint64_t populates{0}, performs{0};
+
+    SyntheticHost()
+    {
+        for (int i = 0; i < 2048; ++i)
+            labels.push_back("Host menu entry number " + std::to_string(i));
+
+        host.host_data = this;
+        host.name = "menu bench";
+        host.get_extension = [](const clap_host_t *h, const char *id) -> const void * {
+            auto *self = static_cast<SyntheticHost *>(h->host_data);
+            return std::strcmp(id, CLAP_EXT_CONTEXT_MENU) == 0 ? &self->ext : nullptr;
+        };
+        host.request_restart = [](const clap_host_t *) {};
+        host.request_process = [](const clap_host_t *) {};
+        host.request_callback = [](const clap_host_t *) {};
+
+        ext.populate = [](const clap_host_t *h, const clap_context_menu_target_t *,
+                          const clap_context_menu_builder_t *b) {
+            auto *self = static_cast<SyntheticHost *>(h->host_data);
+            self->populates++;
+            clap_id next{0};
+            self->emit(b, 0, next);
+            return true;
+        };
+        ext.perform = [](const clap_host_t *h, const clap_context_menu_target_t *, clap_id) {
+            static_cast<SyntheticHost *>(h->host_data)->performs++;
+            return true;
+        };
+    }
+
+    void emit(const clap_context_menu_builder_t *b, int level, clap_id &next) const
+    {
+        auto title = clap_context_menu_item_title_t{labels[next % labels.size()].c_str(), true};
+        b->add_item(b, CLAP_CONTEXT_MENU_ITEM_TITLE, &title);
+        for (int i = 0; i < entriesPerMenu; ++i)
+        {
+            auto *label = labels[next % labels.size()].c_str();
+            if (i % 4 == 3)
+            {
+                auto e = clap_context_menu_check_entry_t{label, true, (next & 1) == 1, next};
+                b->add_item(b, CLAP_CONTEXT_MENU_ITEM_CHECK_ENTRY, &e);
+            }
+            else
+            {
+                auto e = clap_context_menu_entry_t{label, true, next};
+                b->add_item(b, CLAP_CONTEXT_MENU_ITEM_ENTRY, &e);
+            }
+            next++;
+        }
+        if (level == depth)
+            return;
+
+        b->add_item(b, CLAP_CONTEXT_MENU_ITEM_SEPARATOR, nullptr);
+        for (int s = 0; s < fanout; ++s)
+        {
+            auto sub = clap_context_menu_submenu_t{labels[s].c_str(), true};
+            b->add_item(b, CLAP_CONTEXT_MENU_ITEM_BEGIN_SUBMENU, &sub);
+            emit(b, level + 1, next);
+            b->add_item(b, CLAP_CONTEXT_MENU_ITEM_END_SUBMENU, nullptr);
+        }
+    }
+};
+
+int countEntries(const juce::PopupMenu &m)
+{
+    int res{0};
+    for (juce::PopupMenu::MenuItemIterator it(m, true); it.next();)
+        if (!it.getItem().isSeparator && !it.getItem().isSectionHeader &&
+            it.getItem().subMenu == nullptr)
+            res++;
+    return res;
+}
+
+void run(const char *label, int rounds, const std::function<void(juce::PopupMenu &)> &build)
+{
+    Histogram ms, allocs;
+    int entries{0};
+    for (int r = 0; r < rounds; ++r)
+    {
+        juce::PopupMenu m;
+        allocations = 0;
+        countAllocations = true;
+        auto start = nowMs();
+        build(m);
+        ms.record(nowMs() - start);
+        countAllocations = false;
+        allocs.record((double)allocations.load());
+        entries = countEntries(m);
+    }
+    std::printf("  %s: %d entries\n", label, entries);
+    bench::report("build", ms);
+    bench::report("allocations per build", allocs, "");
+    std::printf("    %.2f allocations per entry\n", allocs.percentile(50) / std::max(entries, 1));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    auto rounds = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 200;
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    SyntheticHost h;
+    std::printf("menu: %d entries %d submenus deep, %d builds each\n",
+                SyntheticHost::entriesPerMenu * SyntheticHost::menus, SyntheticHost::depth, rounds);
+
+    setClapMenuCachePolicy({false, 0});
+    run("straight from the host", rounds,
+        [&](juce::PopupMenu &m) { populateMenuForClapParam(m, 1, &h.host); });
+
+    setClapMenuCachePolicy({true, 0});
+    run("from the cache", rounds,
+        [&](juce::PopupMenu &m) { populateMenuForClapParam(m, 1, &h.host); });
+
+    clap_id selection[] = {1, 2, 3, 4};
+    run("merged over four params, cached", rounds / 10 + 1, [&](juce::PopupMenu &m) {
+        populateMenuForClapParams(m, selection, 4, true, &h.host);
+    });
+
+    invalidateClapMenuCache(&h.host);
+    setClapMenuCachePolicy({false, 0});
+    std::printf("  host populated %llu times\n", (unsigned long long)h.populates);
+    return 0;
+}
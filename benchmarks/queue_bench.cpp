@@ -0,0 +1,126 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+/*
+ * Pushes 10k parameter and meter updates per audio block through the audio to gui
+ * channel while a gui thread drains it at 60Hz, timing both sides and counting what
+ * the audio thread allocates. Needs only the clap headers. Run as
+ *
+ *     clap_juce_shim_queue_bench [ids] [blocks]
+ *
+ * Exits non zero if the audio thread allocated or a drain delivered more updates
+ * than there are ids.
+ */
+
+#include "sst/clap_juce_shim/param_queues.h"
+#include "bench_report.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+namespace
+{
+// Only allocations made while this is set on the calling thread are counted
+thread_local bool countAllocations{false};
+std::atomic<uint64_t> allocations{0};
+
+double nowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+void *operator new(size_t n)
+{
+    if (countAllocations)
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t n) { return ::operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char **argv)
+{
+    using namespace sst::clap_juce_shim;
+
+    auto numIds = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 2048;
+    auto blocks = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 2000;
+    constexpr int updatesPerBlock{10000};
+
+    std::printf("queue: %d updates per block over %d ids, %d blocks\n", updatesPerBlock, numIds,
+                blocks);
+
+    std::vector<clap_id> ids;
+    for (int i = 0; i < numIds; ++i)
+        ids.push_back((clap_id)(i * 7 + 100));
+    AudioToGuiParamChannel channel;
+    channel.setParamIds(ids);
+
+    Histogram blockMicroseconds, drainMicroseconds, drainSizes;
+    std::atomic<bool> stop{false};
+
+    std::thread gui([&]() {
+        while (!stop)
+        {
+            auto start = nowMs();
+            auto &batch = channel.drain();
+            drainMicroseconds.record((nowMs() - start) * 1000.0);
+            drainSizes.record((double)batch.size());
+            std::this_thread::sleep_for(std::chrono::microseconds(16667));
+        }
+    });
+
+    // A few hot meters take most of the pushes, the rest sweep across every id
+    uint32_t sweep{0};
+    countAllocations = true;
+    for (int b = 0; b < blocks; ++b)
+    {
+        auto start = nowMs();
+        for (int i = 0; i < updatesPerBlock; ++i)
+        {
+            auto idx = (i & 3) ? (uint32_t)(i & 15) : (sweep++ % (uint32_t)numIds);
+            channel.push(ids[idx], (double)i / updatesPerBlock);
+        }
+        blockMicroseconds.record((nowMs() - start) * 1000.0);
+
+        // Roughly a 256 sample block at 48k
+        std::this_thread::sleep_for(std::chrono::microseconds(5000));
+    }
+    countAllocations = false;
+
+    stop = true;
+    gui.join();
+    channel.drain();
+
+    bench::report("push 10k updates", blockMicroseconds, "us");
+    bench::report("gui drain", drainMicroseconds, "us");
+    bench::report("updates per drain", drainSizes, "");
+    std::printf("  audio thread allocations %llu, unknown ids %llu\n",
+                (unsigned long long)allocations.load(),
+                (unsigned long long)channel.getUnknownIdCount());
+
+    auto ok = allocations == 0 && drainSizes.max() <= numIds;
+    if (!ok)
+        std::printf("  FAILED\n");
+    return ok ? 0 : 1;
+}
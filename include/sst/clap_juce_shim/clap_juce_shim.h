@@ -15,10 +15,17 @@
 #include <functional>
 #include <memory>
 #include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
 
 #include "clap/ext/gui.h"
 #include "clap/ext/posix-fd-support.h"
 
+#include "sst/clap_juce_shim/param_queues.h"
+#include "sst/clap_juce_shim/timer_wheel.h"
+#include "sst/clap_juce_shim/histogram.h"
+
 #ifndef INC_CH_SST_CLAP_JUCE_SHIM_CLAP_JUCE_SHIM_H
 #define INC_CH_SST_CLAP_JUCE_SHIM_CLAP_JUCE_SHIM_H
 
@@ -27,13 +34,48 @@ static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20
 namespace juce
 {
 class Component;
+class Image;
 }
 namespace sst::clap_juce_shim
 {
 namespace details
 {
 struct Implementor;
-}
+struct PumpCoordinator;
+} // namespace details
+
+/*
+ * Sizes an editor accepts, in unscaled editor pixels. A zero min or max leaves that
+ * side unconstrained and an aspect ratio (width / height) of zero leaves it free.
+ * Sizes snap down to multiples of the step, counted from the minimum. If
+ * scaleWithGui is set the limits are multiplied by the gui scale before being
+ * compared with host sizes.
+ */
+struct EditorSizeConstraints
+{
+    uint32_t minWidth{0}, minHeight{0};
+    uint32_t maxWidth{0}, maxHeight{0};
+    double aspectRatio{0};
+    uint32_t widthStep{1}, heightStep{1};
+    bool scaleWithGui{true};
+};
+
+// Pure and lock free, so hosts can call guiAdjustSize in a tight loop
+void adjustSizeToConstraints(const EditorSizeConstraints &c, double scale, uint32_t &width,
+                             uint32_t &height) noexcept;
+
+/*
+ * Builds an editor a slice at a time so guiCreate does not block the host. The shim
+ * shows a placeholder at the initial size, calls step from its message loop with a
+ * time budget until it returns true, and then swaps in the result of takeEditor.
+ */
+struct IncrementalEditorBuilder
+{
+    virtual ~IncrementalEditorBuilder() = default;
+    virtual void getInitialSize(uint32_t &width, uint32_t &height) = 0;
+    virtual bool step(double budgetMilliseconds) = 0;
+    virtual std::unique_ptr<juce::Component> takeEditor() = 0;
+};
 
 struct EditorProvider
 {
@@ -41,6 +83,35 @@ struct EditorProvider
     virtual std::unique_ptr<juce::Component> createEditor() = 0;
     virtual bool registerOrUnregisterTimer(clap_id &, int, bool) = 0;
     virtual bool registerOrUnregisterPosixFd(int fd, clap_posix_fd_flags_t flags, bool) = 0;
+
+    // Return false to let the host pick any size, which is the default
+    virtual bool getSizeConstraints(EditorSizeConstraints &) { return false; }
+
+    // Weight of a hibernated editor against the hibernation budget. Zero means use
+    // the size of its backing image.
+    virtual uint64_t getHibernatedEditorMemoryEstimate() { return 0; }
+
+    // Return a builder to construct the editor incrementally instead of with createEditor
+    virtual std::unique_ptr<IncrementalEditorBuilder> createIncrementalEditorBuilder()
+    {
+        return nullptr;
+    }
+
+    // Called on guiHide and the following guiShow. Stop and restart editor timers here.
+    virtual void editorVisibilityChanged(bool /*visible*/) {}
+
+    // The latest values pushed to ClapJuceShim::audioToGui, once per pump tick
+    virtual void onParamValuesFromAudio(const AudioToGuiParamChannel::Update * /*updates*/,
+                                        size_t /*count*/)
+    {
+    }
+
+    /*
+     * Return true if the editor and everything in it can paint from several threads
+     * at once, with the message thread blocked meanwhile. Only then does
+     * ClapJuceShim::setTiledRendering take effect.
+     */
+    virtual bool editorSupportsParallelPaint() { return false; }
 };
 
 #if SHIM_LINUX
@@ -72,6 +143,156 @@ struct ClapJuceShim
     bool guiGetSize(uint32_t *width, uint32_t *height) noexcept;
 
     bool guiShow() noexcept;
+    bool guiHide() noexcept;
+    bool isEditorHidden() const { return guiHidden; }
+
+    /*
+     * Push from the audio thread after registering ids with audioToGui.setParamIds.
+     * While the editor is showing the shim drains it once per tick (the pump tick on
+     * linux, a juce::Timer elsewhere) into EditorProvider::onParamValuesFromAudio.
+     */
+    AudioToGuiParamChannel audioToGui;
+
+    /*
+     * Editors post gestures and values here from any thread. Set the ids and host up
+     * front, then drain into the output events of process() and params flush().
+     */
+    GuiToAudioParamQueue guiToAudio;
+
+    /*
+     * Editor timers can share the shim's timer wheel rather than each running its own
+     * juce::Timer. Call these on the message thread; callbacks run there while the
+     * editor is showing and are cancelled when it is destroyed, or when a hibernated
+     * editor is evicted from the hibernation budget. On linux the wheel rides the host
+     * timer, elsewhere one juce::Timer is re-armed to the next deadline.
+     */
+    TimerWheel::Handle scheduleTimer(double periodMs, TimerWheel::Callback cb,
+                                     double firstDelayMs = -1);
+    TimerWheel::Handle scheduleTimerOnce(double delayMs, TimerWheel::Callback cb);
+    void cancelTimer(TimerWheel::Handle h);
+    struct TimerStats
+    {
+        TimerWheel::Stats wheel;
+        uint64_t wakeups{0};
+        // Against one wakeup per callback, and a blind timer at the tightest interval
+        uint64_t wakeupsSaved{0};
+    };
+    TimerStats getTimerStats() const;
+
+    /*
+     * Off by default. When on, guiSetSize records the latest size and applies it once
+     * per message loop iteration rather than relaying out on every call of a host drag.
+     * guiGetSize reports the requested size right away either way.
+     */
+    void setCoalesceResizes(bool b) { coalesceResizes = b; }
+
+    // Constraints are read from the EditorProvider at guiCreate. Call this if they change.
+    void updateSizeConstraints() noexcept;
+    struct ResizeStats
+    {
+        uint64_t requested{0};
+        uint64_t applied{0};
+    };
+    ResizeStats getResizeStats() const noexcept;
+
+    /*
+     * While enabled, every frame records how long the whole hierarchy took to paint,
+     * the area JUCE repainted and which top level children of the editor that covered,
+     * as well as pump duration and message counts on linux. The overlay draws the main
+     * percentiles over the editor. With instrumentation on, cmd/ctrl-shift-alt-I also
+     * toggles it when the editor does not use the key. The setters run on the message
+     * thread wherever they are called from; reset and read from the message thread.
+     */
+    void setInstrumentationEnabled(bool b);
+    void setInstrumentationOverlayVisible(bool b);
+    void resetInstrumentation();
+    struct Instrumentation
+    {
+        Histogram frameMilliseconds;
+        Histogram dirtyPixels;
+        Histogram pumpMilliseconds;
+        Histogram pumpMessages;
+        std::vector<std::pair<std::string, uint64_t>> subtreeRepaints; // most repainted first
+        // Background pixels the desktop and holder wrappers filled, and skipped as covered
+        // by an opaque child, whether or not instrumentation is enabled. Paints where
+        // JUCE skipped the wrapper's paint() altogether count as skipped.
+        uint64_t wrapperPixelsFilled{0};
+        uint64_t wrapperPixelsSkipped{0};
+    };
+    Instrumentation getInstrumentation() const;
+
+    /*
+     * Paint the editor through a cached image whose invalid tiles are rasterised in
+     * parallel on a small worker pool, rather than all on the message thread. Meant
+     * for large editors on software rendered linux. Ignored unless the provider says
+     * editorSupportsParallelPaint, or if the editor has its own cached image.
+     */
+    void setTiledRendering(bool b);
+
+    /*
+     * Paint the editor and its children into a software image, whether or not it is on
+     * a window, for paint benchmarks, pixel tests and thumbnails. The size is in editor
+     * pixels, zero meaning the current size, and the image is scale times that. The
+     * editor is laid out at that size for the render and then put back. Returns a null
+     * image if there is no editor.
+     */
+    juce::Image renderToImage(int width = 0, int height = 0, double scale = 1.0);
+
+    /*
+     * With hibernation on, guiDestroy detaches the editor instead of deleting it
+     * and the next guiCreate reattaches the same one, skipping createEditor. This
+     * means the editor outlives guiDestroy, so only turn it on if the editor can
+     * cope with that. Hibernated editors from all instances share one budget. Past
+     * it the least recently hibernated editor is destroyed for real.
+     */
+    void setHibernateOnDestroy(bool b) { hibernateOnDestroy = b; }
+    struct HibernationBudget
+    {
+        uint32_t maxEditors{4};
+        uint64_t maxBytes{256 * 1024 * 1024}; // zero for no limit
+    };
+    struct HibernationStats
+    {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t evictions{0};
+        uint32_t hibernatingEditors{0};
+        uint64_t hibernatingBytes{0};
+    };
+    static void setHibernationBudget(const HibernationBudget &b) noexcept;
+    static HibernationStats getHibernationStats() noexcept;
+
+    // Times are from the start of the most recent editor construction in guiCreate
+    struct EditorBuildStats
+    {
+        bool incremental{false};
+        uint32_t steps{0};
+        double timeToFirstFrameMs{0};
+        double timeToInteractiveMs{0};
+    };
+    const EditorBuildStats &getEditorBuildStats() const { return editorBuildStats; }
+    void setIncrementalBuildStepBudget(double ms) { incrementalBuildStepMs = ms; }
+
+    /*
+     * Process wide wall clock cost of the gui lifecycle calls, and counts of live
+     * shims and editor hierarchies, for hosts and soak runs looking for latency
+     * regressions or leaks. Resident bytes are sampled when the stats are read and
+     * are zero on windows. Safe to call from any thread.
+     */
+    struct LifecycleStats
+    {
+        Histogram guiCreateMilliseconds;
+        Histogram guiSetParentMilliseconds;
+        Histogram guiShowMilliseconds;
+        Histogram guiDestroyMilliseconds;
+        uint32_t liveShims{0};
+        uint32_t liveEditors{0};
+        uint64_t shimsCreated{0};
+        uint64_t editorsCreated{0};
+        uint64_t residentBytes{0};
+    };
+    static LifecycleStats getLifecycleStats() noexcept;
+    static void resetLifecycleTimings() noexcept;
 
 #if SHIM_LINUX
     std::unique_ptr<PosixFdSupport> posixFdSupport;
@@ -79,6 +300,77 @@ struct ClapJuceShim
     void onTimer(clap_id timerId) noexcept;
     void onPosixFd(int fd, clap_posix_fd_flags_t) noexcept;
 
+    /*
+     * The idle timer drains the JUCE message queue on the host main thread. To
+     * avoid stalling the host on a burst of messages, each tick stops once either
+     * limit is reached and leaves the rest for the next tick. A limit of zero means
+     * unbounded. At least one message is always dispatched per tick.
+     */
+    struct PumpBudget
+    {
+        uint32_t maxDispatchesPerTick{0};
+        double maxMillisecondsPerTick{8.0};
+    };
+    void setPumpBudget(const PumpBudget &b) { pumpBudget = b; }
+    const PumpBudget &getPumpBudget() const { return pumpBudget; }
+
+    /*
+     * The queue is shared by every editor in the process, so only one attached shim
+     * drains it each tick and the stats are process wide.
+     */
+    struct PumpStats
+    {
+        uint64_t hostTicks{0};    // onTimer calls from all instances
+        uint64_t skippedTicks{0}; // onTimer calls which left the pumping to another shim
+        uint64_t leaderChanges{0};
+        uint64_t ticks{0}; // ticks which actually pumped
+        uint64_t dispatches{0};
+        uint64_t budgetExceeded{0}; // ticks which stopped with work still queued
+        uint64_t lastBacklog{0};    // dispatches it took to clear the latest overrun
+        uint64_t maxBacklog{0};
+        double pumpMilliseconds{0};
+        double ticksPerSecond{0};            // over the last full second
+        double pumpMillisecondsPerSecond{0}; // over the last full second
+        uint32_t attachedShims{0};
+    };
+    static PumpStats getPumpStats() noexcept;
+
+    /*
+     * The idle timer runs at maxHz while there is work to do and falls back to minHz
+     * once quietMilliseconds pass without any. Repaints and juce::Timers arrive as
+     * messages, so any pending message counts as work. An editor running something
+     * not visible to the queue can call requestFastIdle to stay at the fast rate.
+     */
+    struct IdleTimerRates
+    {
+        uint32_t minHz{10};
+        uint32_t maxHz{120};
+        uint32_t quietMilliseconds{500};
+    };
+    void setIdleTimerRates(const IdleTimerRates &r) noexcept;
+    const IdleTimerRates &getIdleTimerRates() const { return idleTimerRates; }
+    uint32_t getIdleTimerHz() const { return idleTimerHz; }
+    void requestFastIdle() noexcept;
+
+    // Process wide counts of host fd registration calls and onPosixFd wakeups
+    struct PosixFdStats
+    {
+        uint64_t hostRegistrations{0};
+        uint64_t hostUnregistrations{0};
+        uint64_t wakeups{0};
+        uint64_t staleWakeups{0}; // wakeups for an fd owned by another instance
+    };
+    static PosixFdStats getPosixFdStats() noexcept;
+
+    /*
+     * Run JUCE on its own message thread rather than pumping it from the host timer
+     * and fd callbacks, so editor work stops competing with the host UI. This is
+     * process wide and has to be set before the first guiCreate. The gui calls are
+     * then marshalled onto that thread and no host timer or fds get registered. The
+     * thread runs from the first guiCreate until the last open editor's guiDestroy.
+     */
+    static void setUseDedicatedMessageThread(bool b) noexcept;
+    static bool getUseDedicatedMessageThread() noexcept;
 #endif
 
     EditorProvider *editorProvider;
@@ -94,7 +386,50 @@ struct ClapJuceShim
 
   private:
     double guiScale{1.0};
-    void dumpSizeDebugInfo(const std::string &pfx, const std::string &func, int line);
+
+    // width and height of the desktop component, in host pixels, packed with a valid
+    // bit so the host can query the size from any thread without a lock
+    static constexpr uint64_t hasPublishedSizeBit{1ULL << 63};
+    std::atomic<uint64_t> publishedSize{0};
+    void publishSize(int w, int h) noexcept;
+    bool getPublishedSize(uint32_t &w, uint32_t &h) const noexcept;
+
+    bool hasSizeConstraints{false};
+    EditorSizeConstraints sizeConstraints;
+
+    bool guiHidden{false};
+    bool hibernateOnDestroy{false};
+    void createOrWakeEditor();
+
+    EditorBuildStats editorBuildStats;
+    double incrementalBuildStepMs{4.0};
+
+    friend struct details::PumpCoordinator;
+    void deliverAudioToGuiUpdates() noexcept;
+    void setMessageThreadTimersRunning(bool b) noexcept;
+
+    TimerWheel timerWheel;
+    TimerStats timerStats;
+    double lastTimerWakeMs{0};
+    void runTimerWheel() noexcept;
+    void rearmTimerWheel() noexcept;
+
+    bool coalesceResizes{false};
+    std::atomic<uint64_t> resizesRequested{0}, resizesApplied{0};
+    void applySize(int w, int h);
+#if SHIM_LINUX
+    PumpBudget pumpBudget;
+
+    IdleTimerRates idleTimerRates;
+    uint32_t idleTimerHz{0};
+    double lastActivityMs{0};
+    void setIdleTimerHz(uint32_t hz) noexcept;
+    void noteIdleActivity(bool active) noexcept;
+    uint32_t timerWheelHz() const noexcept;
+    void startHostPump() noexcept;
+    void stopHostPump() noexcept;
+#endif
+    void traceSizes(const char *label);
 };
 } // namespace sst::clap_juce_shim
 
@@ -127,7 +462,9 @@ struct ClapJuceShim
         return clapJuceShim->guiGetSize(width, height);                                            \
     }                                                                                              \
     bool guiShow() noexcept override { return clapJuceShim->guiShow() && onShow(); }               \
-    std::function<bool(void)> onShow{[]() { return true; }};
+    bool guiHide() noexcept override { return clapJuceShim->guiHide() && onHide(); }               \
+    std::function<bool(void)> onShow{[]() { return true; }};                                       \
+    std::function<bool(void)> onHide{[]() { return true; }};
 
 #if SHIM_LINUX
 #define ADD_SHIM_LINUX_TIMER(clapJuceShim)                                                         \
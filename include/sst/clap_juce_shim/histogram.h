@@ -0,0 +1,99 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef INC_CH_SST_CLAP_JUCE_SHIM_HISTOGRAM_H
+#define INC_CH_SST_CLAP_JUCE_SHIM_HISTOGRAM_H
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+namespace sst::clap_juce_shim
+{
+/*
+ * A fixed size histogram of positive values with log spaced buckets: each power of
+ * two from 2^-10 to 2^31 is split into eight, so a percentile is good to within
+ * about 12%. Recording never allocates. Values at or below zero land in the first
+ * bucket and values past the top in the last.
+ */
+struct Histogram
+{
+    void record(double v) noexcept
+    {
+        buckets[bucketFor(v)]++;
+        if (n == 0 || v < minV)
+            minV = v;
+        if (n == 0 || v > maxV)
+            maxV = v;
+        sum += v;
+        n++;
+    }
+
+    // p from 0 to 100. Reports the top of the bucket holding it, capped at the max seen.
+    double percentile(double p) const noexcept
+    {
+        if (n == 0)
+            return 0;
+
+        auto rank = (uint64_t)std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * n);
+        rank = std::max(rank, (uint64_t)1);
+        uint64_t seen{0};
+        for (size_t i = 0; i < numBuckets; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::clamp(upperEdge(i), minV, maxV);
+        }
+        return maxV;
+    }
+
+    uint64_t count() const { return n; }
+    double mean() const { return n ? sum / n : 0; }
+    double min() const { return minV; }
+    double max() const { return maxV; }
+
+    void reset() { *this = Histogram(); }
+
+  private:
+    static constexpr int subBuckets{8}, minExp{-10}, maxExp{31};
+    static constexpr size_t numBuckets{(maxExp - minExp) * subBuckets + 1};
+
+    static size_t bucketFor(double v) noexcept
+    {
+        if (!(v > 0))
+            return 0;
+        int e;
+        auto m = std::frexp(v, &e); // v = m * 2^e with m in [0.5, 1)
+        auto idx = (int64_t)(e - 1 - minExp) * subBuckets + (int64_t)((2 * m - 1) * subBuckets);
+        return (size_t)std::clamp(idx + 1, (int64_t)1, (int64_t)numBuckets - 1);
+    }
+
+    static double upperEdge(size_t i) noexcept
+    {
+        if (i == 0)
+            return 0;
+        auto k = (int)i - 1;
+        return std::ldexp(1.0 + (double)(k % subBuckets + 1) / subBuckets, minExp + k / subBuckets);
+    }
+
+    std::array<uint64_t, numBuckets> buckets{};
+    uint64_t n{0};
+    double sum{0}, minV{0}, maxV{0};
+};
+} // namespace sst::clap_juce_shim
+
+#endif // INC_CH_SST_CLAP_JUCE_SHIM_HISTOGRAM_H
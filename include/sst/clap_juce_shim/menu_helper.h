@@ -27,6 +27,40 @@ namespace sst::clap_juce_shim
 {
 // If there's a host extension for menus, add a separator then the menus
 void populateMenuForClapParam(juce::PopupMenu &, clap_id paramId, const clap_host_t *host);
+
+/*
+ * The same for a multi selection, and the global target if asked. Only entries every
+ * param has are shown, each merged into one which performs on all of them, and is
+ * enabled or checked only if it is for all of them. Global entries follow in a
+ * section of their own. Each target is still one populate call to the host, so use
+ * this with the cache below to keep large selections quick.
+ */
+void populateMenuForClapParams(juce::PopupMenu &, const clap_id *paramIds, size_t count,
+                               bool includeGlobal, const clap_host_t *host);
+
+/*
+ * Hosts can take a while to populate a menu, so with the cache on what populate gives
+ * for a host and target is kept and the next right click is built from that instead.
+ * An entry lives until invalidated, until one of its actions is performed, or for
+ * the time to live if that is above zero. Prefetch on hover to have the menu ready
+ * before the click. All of these are for the message thread only.
+ */
+struct ClapMenuCachePolicy
+{
+    bool enabled{false};
+    double timeToLiveSeconds{0};
+};
+void setClapMenuCachePolicy(const ClapMenuCachePolicy &);
+
+// Fills the cache for the param on a later turn of the message loop, if it is stale
+void prefetchMenuForClapParam(clap_id paramId, const clap_host_t *host);
+void prefetchMenuForClapParams(const clap_id *paramIds, size_t count, bool includeGlobal,
+                               const clap_host_t *host);
+
+// Drop the cached menu for one param, or everything for a host including its global
+// menu. Call the latter before the host goes away, which also cancels pending prefetches.
+void invalidateClapMenuCache(clap_id paramId, const clap_host_t *host);
+void invalidateClapMenuCache(const clap_host_t *host);
 }; // namespace sst::clap_juce_shim
 
 #endif // MENU_HELPER_H
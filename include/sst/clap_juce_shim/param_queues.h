@@ -0,0 +1,168 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef INC_CH_SST_CLAP_JUCE_SHIM_PARAM_QUEUES_H
+#define INC_CH_SST_CLAP_JUCE_SHIM_PARAM_QUEUES_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include <clap/clap.h>
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+namespace sst::clap_juce_shim
+{
+/*
+ * Carries parameter and meter values from the audio thread to the editor. Each
+ * registered id has a slot holding its latest value, and a slot is queued for the
+ * gui only on its first change since the last drain. However many values the audio
+ * thread pushes, a drain therefore delivers at most one update per id.
+ *
+ * One producer (the audio thread) and one consumer (the gui). push is wait free and
+ * never allocates. setParamIds allocates and must not race with either side.
+ */
+struct AudioToGuiParamChannel
+{
+    struct Update
+    {
+        clap_id id;
+        double value;
+    };
+
+    void setParamIds(const std::vector<clap_id> &ids);
+
+    bool push(clap_id id, double value) noexcept
+    {
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it == ids.end() || *it != id)
+        {
+            unknownIds.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto idx = (uint32_t)(it - ids.begin());
+        auto &s = slots[idx];
+        s.value.store(value, std::memory_order_relaxed);
+        if (!s.queued.exchange(true, std::memory_order_acq_rel))
+        {
+            // Each slot is queued at most once, so the ring can never fill
+            auto w = writePos.load(std::memory_order_relaxed);
+            ring[w] = idx;
+            writePos.store(w + 1 == ringSize ? 0 : w + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // gui thread. The returned batch is reused by the next drain.
+    const std::vector<Update> &drain() noexcept;
+
+    size_t size() const { return ids.size(); }
+    uint64_t getUnknownIdCount() const { return unknownIds.load(std::memory_order_relaxed); }
+
+  private:
+    struct Slot
+    {
+        std::atomic<double> value{0};
+        std::atomic<bool> queued{false};
+    };
+
+    std::vector<clap_id> ids;
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<uint32_t[]> ring;
+    uint32_t ringSize{0};
+    std::atomic<uint32_t> writePos{0}, readPos{0};
+    std::atomic<uint64_t> unknownIds{0};
+    std::vector<Update> batch;
+};
+
+/*
+ * Carries edits from the editor to the audio side as clap gesture and value events.
+ * Any thread may post and nothing allocates after setParamIds. Value changes to an
+ * id are coalesced until the next drain, keeping only the latest value, but never
+ * across a gesture begin or end for that id: a gesture seals the value queued
+ * before it, so begin, 0.2, end, begin, 0.9, end still drains as all six events.
+ * Drain from process() or params flush(), which the host never runs concurrently.
+ *
+ * With a host set, the first post after a drain calls the host's request_callback,
+ * so a batch costs one request however many edits it carries.
+ */
+struct GuiToAudioParamQueue
+{
+    void setParamIds(const std::vector<clap_id> &ids);
+    void setHost(const clap_host_t *h) { host = h; }
+
+    bool postGestureBegin(clap_id id) noexcept { return postGesture(id, Event::BEGIN); }
+    bool postGestureEnd(clap_id id) noexcept { return postGesture(id, Event::END); }
+    bool postValue(clap_id id, double value) noexcept;
+
+    // Returns the number of events pushed to out
+    uint32_t drain(const clap_output_events_t *out) noexcept;
+
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+  private:
+    struct Event
+    {
+        enum Kind : uint32_t
+        {
+            BEGIN,
+            END,
+            VALUE
+        } kind;
+        uint32_t slot;
+        uint32_t generation{0}; // of the slot when a value was queued
+        bool sealed{false};     // a gesture carrying the value queued before it
+        double value{0};
+    };
+    struct Cell
+    {
+        std::atomic<size_t> seq{0};
+        Event event;
+    };
+    struct Slot
+    {
+        std::atomic<double> value{0};
+        // generation << 1 | queued. Sealing bumps the generation, so the value event
+        // queued before the gesture goes stale and the gesture carries the value.
+        std::atomic<uint32_t> state{0};
+    };
+
+    int32_t slotFor(clap_id id) const noexcept
+    {
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it == ids.end() || *it != id)
+            return -1;
+        return (int32_t)(it - ids.begin());
+    }
+    bool postGesture(clap_id id, Event::Kind k) noexcept;
+    bool enqueue(const Event &e) noexcept;
+    bool dequeue(Event &e) noexcept;
+    void requestCallbackOnce() noexcept;
+
+    std::vector<clap_id> ids;
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<Cell[]> cells;
+    size_t mask{0};
+    std::atomic<size_t> enqueuePos{0}, dequeuePos{0};
+    std::atomic<bool> batchRequested{false};
+    std::atomic<uint64_t> dropped{0};
+    const clap_host_t *host{nullptr};
+};
+} // namespace sst::clap_juce_shim
+
+#endif // INC_CH_SST_CLAP_JUCE_SHIM_PARAM_QUEUES_H
@@ -0,0 +1,108 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef INC_CH_SST_CLAP_JUCE_SHIM_TIMER_WHEEL_H
+#define INC_CH_SST_CLAP_JUCE_SHIM_TIMER_WHEEL_H
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+namespace sst::clap_juce_shim
+{
+/*
+ * A hierarchical timer wheel with millisecond ticks. Four levels of 64 slots cover
+ * about 4.6 hours, with longer delays parked in the top level until they come due.
+ * Scheduling and cancelling are O(1) and advancing costs one slot per elapsed tick
+ * plus a cascade every 64, so dozens of editor timers share a single wakeup.
+ *
+ * Not thread safe. Use it from the message thread only. Callbacks may schedule and
+ * cancel timers, including their own.
+ */
+struct TimerWheel
+{
+    using Handle = uint64_t; // zero is never a valid handle
+    using Callback = std::function<void()>;
+
+    // Fires every periodMs, first after firstDelayMs (or periodMs if negative)
+    Handle schedule(double periodMs, Callback cb, double firstDelayMs = -1);
+    Handle scheduleOnce(double delayMs, Callback cb);
+    void cancel(Handle h);
+    void cancelAll();
+
+    // Runs everything due by now. Returns the number of callbacks fired.
+    uint32_t advance();
+
+    bool empty() const { return active == 0; }
+    // Milliseconds until the earliest deadline, 0 if overdue, negative if empty
+    double millisecondsToNextDeadline() const;
+    // The shortest period or one shot delay among live timers, negative if empty
+    double shortestIntervalMilliseconds() const;
+
+    struct Stats
+    {
+        uint64_t scheduled{0};
+        uint64_t cancelled{0};
+        uint64_t fired{0};
+        uint64_t cascades{0};
+        uint32_t active{0};
+    };
+    Stats getStats() const
+    {
+        auto s = stats;
+        s.active = active;
+        return s;
+    }
+
+  private:
+    static constexpr int levelBits{6}, levels{4};
+    static constexpr uint64_t slotsPerLevel{1ULL << levelBits}, slotMask{slotsPerLevel - 1};
+
+    struct Entry
+    {
+        uint64_t due{0};
+        uint64_t interval{0};
+        bool periodic{false};
+        bool live{false};
+        uint32_t generation{0};
+        Callback cb;
+    };
+
+    static uint64_t nowTick();
+    static Handle makeHandle(uint32_t idx, uint32_t gen) { return ((uint64_t)gen << 32) | idx; }
+    Entry *lookup(Handle h);
+    Handle add(uint64_t interval, uint64_t firstDelay, bool periodic, Callback &&cb);
+    void insert(Handle h, uint64_t due);
+    void release(uint32_t idx);
+    void cascade(int level);
+
+    // A deque so a running callback is never moved by one it schedules
+    std::deque<Entry> entries;
+    std::vector<uint32_t> freeList;
+    std::array<std::array<std::vector<Handle>, slotsPerLevel>, levels> wheel;
+    std::array<size_t, levels> levelCount{};
+    std::vector<Handle> firingSlot;
+    uint64_t currentTick{nowTick()};
+    uint32_t active{0};
+    int64_t firing{-1};
+    bool releaseFiring{false};
+    Stats stats;
+};
+} // namespace sst::clap_juce_shim
+
+#endif // INC_CH_SST_CLAP_JUCE_SHIM_TIMER_WHEEL_H
@@ -0,0 +1,107 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef INC_CH_SST_CLAP_JUCE_SHIM_TRACE_H
+#define INC_CH_SST_CLAP_JUCE_SHIM_TRACE_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+/*
+ * A runtime trace of what the shim (and anyone else who cares to) is doing. Each
+ * thread records timestamped events into its own fixed size ring, so recording
+ * takes no lock and overwrites the oldest events once full. While tracing is off
+ * recording is a single relaxed load. Export the rings as Chrome trace JSON, which
+ * chrome://tracing and Perfetto both open.
+ *
+ * Names, categories and arg names are kept by pointer and so must outlive the
+ * trace. Use string literals or __func__.
+ */
+namespace sst::clap_juce_shim::trace
+{
+namespace details
+{
+extern std::atomic<bool> enabledFlag;
+}
+
+inline bool enabled() noexcept { return details::enabledFlag.load(std::memory_order_relaxed); }
+void setEnabled(bool b) noexcept;
+
+struct Arg
+{
+    Arg() = default;
+    template <typename T> Arg(const char *n, T v) : name(n), value((double)v) {}
+
+    const char *name{nullptr};
+    double value{0};
+};
+
+double nowMicroseconds() noexcept;
+
+void instant(const char *name, const char *category, Arg a0 = {}, Arg a1 = {}, Arg a2 = {},
+             Arg a3 = {}) noexcept;
+void begin(const char *name, const char *category, Arg a0 = {}, Arg a1 = {}) noexcept;
+void end(const char *name, const char *category) noexcept;
+void complete(const char *name, const char *category, double startUs, double durationUs,
+              Arg a0 = {}, Arg a1 = {}) noexcept;
+
+// Records one complete event spanning its lifetime, if tracing was on at construction
+struct Scope
+{
+    Scope(const char *n, const char *c, Arg a0 = {}, Arg a1 = {})
+    {
+        if (enabled())
+        {
+            name = n;
+            category = c;
+            args[0] = a0;
+            args[1] = a1;
+            start = nowMicroseconds();
+        }
+    }
+    ~Scope()
+    {
+        if (name)
+            complete(name, category, start, nowMicroseconds() - start, args[0], args[1]);
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    const char *name{nullptr}, *category{nullptr};
+    Arg args[2];
+    double start{0};
+};
+
+// Drops every recorded event. Threads keep their rings.
+void clear() noexcept;
+
+// Dropped counts events from threads past the ring limit
+struct Stats
+{
+    uint32_t threads{0};
+    uint64_t recorded{0};
+    uint64_t overwritten{0};
+    uint64_t dropped{0};
+};
+Stats getStats() noexcept;
+
+std::string exportChromeJson();
+bool writeChromeJson(const std::string &path);
+} // namespace sst::clap_juce_shim::trace
+
+#endif // INC_CH_SST_CLAP_JUCE_SHIM_TRACE_H
@@ -11,41 +11,541 @@
  * All source in sst-jucegui available at
  * https://github.com/surge-synthesizer/sst-clap-helpers
  */
-#include <iostream>
 #include "sst/clap_juce_shim/clap_juce_shim.h"
+#include "sst/clap_juce_shim/trace.h"
 
 #define JUCE_GUI_BASICS_INCLUDE_XHEADERS 1
 #include <juce_gui_basics/juce_gui_basics.h>
 
 #if JUCE_LINUX
 #include <vector>
+#include <cstdio>
+#include <unistd.h>
 #include <juce_events/native/juce_EventLoopInternal_linux.h>
 #include <juce_audio_plugin_client/detail/juce_LinuxMessageThread.h>
 #endif
 
 #include <memory>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <cmath>
+
+#if JUCE_MAC
+#include <mach/mach.h>
+#endif
 
 #if JUCE_WINDOWS
 #include <juce_gui_basics/native/juce_WindowsHooks_windows.h>
 #endif
 
-#define FLF __FILE__ << ":" << __LINE__ << " " << __func__ << " "
+// Records the enclosing function in the runtime trace. See trace.h to turn it on.
+#define TRACE trace::Scope shimTraceScope(__func__, "shim")
+
+namespace sst::clap_juce_shim
+{
+namespace details
+{
+#if JUCE_LINUX
+/*
+ * In dedicated thread mode JUCE runs its own message loop on the plugin client's
+ * MessageThread instead of being pumped from the host timer and fd callbacks. Like
+ * the gui lifetime it is shared by every shim, and it runs while any of them has an
+ * editor: each takes a hold in guiCreate and drops it in guiDestroy.
+ */
+struct DedicatedMessageThread
+{
+    static bool &enabled()
+    {
+        static bool res{false};
+        return res;
+    }
+
+    static void acquire()
+    {
+        if (users()++ > 0)
+            return;
+
+        auto &t = thread();
+        if (t)
+            t->start();
+        else
+            t = std::make_unique<juce::detail::MessageThread>();
+    }
+
+    static void release()
+    {
+        jassert(users() > 0);
+        if (--users() > 0)
+            return;
+
+        thread()->stop();
+
+        // Hand the message manager back to the host thread, which may shut JUCE down
+        juce::MessageManager::getInstance()->setCurrentThreadAsMessageThread();
+    }
+
+    static bool isRunning() { return thread() && thread()->isRunning(); }
+
+    // Deleting the thread stops the message manager's dispatch loop for good, so a
+    // stopped thread is kept for the next editor and only goes when JUCE does
+    static void discard()
+    {
+        jassert(users() == 0);
+        thread().reset();
+    }
+
+  private:
+    static std::unique_ptr<juce::detail::MessageThread> &thread()
+    {
+        static std::unique_ptr<juce::detail::MessageThread> res;
+        return res;
+    }
+    static int &users()
+    {
+        static int res{0};
+        return res;
+    }
+};
+#endif
+
+/*
+ * JUCE GUI initialisation is owned by the library rather than by each call. Every
+ * shim takes one lease in guiCreate and drops it in guiDestroy, or when destroyed
+ * while a hibernated editor kept it, and the last lease out shuts JUCE down. Nothing
+ * on the timer or fd paths touches it.
+ */
+struct JuceGuiLifetime
+{
+    static void acquire()
+    {
+        if (leases()++ == 0)
+            initialiser() = std::make_unique<juce::ScopedJuceInitialiser_GUI>();
+    }
+
+    static void release()
+    {
+        jassert(leases() > 0);
+        if (--leases() > 0)
+            return;
+
+#if JUCE_LINUX
+        DedicatedMessageThread::discard();
+#endif
+        initialiser().reset();
+    }
+
+  private:
+    static int &leases()
+    {
+        static int res{0};
+        return res;
+    }
+    static std::unique_ptr<juce::ScopedJuceInitialiser_GUI> &initialiser()
+    {
+        static std::unique_ptr<juce::ScopedJuceInitialiser_GUI> res;
+        return res;
+    }
+};
+
+// Runs f on the JUCE message thread, blocking until it is done. Unless a dedicated
+// message thread is running that is the calling thread.
+inline void runOnMessageThread(const std::function<void()> &f)
+{
+#if JUCE_LINUX
+    if (DedicatedMessageThread::isRunning() &&
+        !juce::MessageManager::getInstance()->isThisTheMessageThread())
+    {
+        juce::WaitableEvent done;
+        juce::MessageManager::callAsync([&f, &done]() {
+            f();
+            done.signal();
+        });
+        done.wait();
+        return;
+    }
+#endif
+    f();
+}
+
+/*
+ * Process wide lifecycle latencies and live counts. The gui calls come from the
+ * host main thread but the stats may be read from any, hence the lock.
+ */
+struct Lifecycle
+{
+    static Lifecycle &get()
+    {
+        static Lifecycle res;
+        return res;
+    }
+
+    // Records the wall clock time of the enclosing gui call
+    struct Timed
+    {
+        explicit Timed(Histogram ClapJuceShim::LifecycleStats::*h)
+            : which(h), start(juce::Time::getMillisecondCounterHiRes())
+        {
+        }
+        ~Timed()
+        {
+            auto ms = juce::Time::getMillisecondCounterHiRes() - start;
+            auto &l = Lifecycle::get();
+            std::lock_guard<std::mutex> g(l.lock);
+            (l.stats.*which).record(ms);
+        }
+        Timed(const Timed &) = delete;
+        Timed &operator=(const Timed &) = delete;
+
+        Histogram ClapJuceShim::LifecycleStats::*which;
+        double start;
+    };
+
+    void shimBorn()
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stats.liveShims++;
+        stats.shimsCreated++;
+    }
+    void shimGone()
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stats.liveShims--;
+    }
+    void editorBorn()
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stats.liveEditors++;
+        stats.editorsCreated++;
+    }
+    void editorGone()
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stats.liveEditors--;
+    }
+
+    ClapJuceShim::LifecycleStats getStats()
+    {
+        std::lock_guard<std::mutex> g(lock);
+        auto res = stats;
+        res.residentBytes = residentBytes();
+        return res;
+    }
+
+    void resetTimings()
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stats.guiCreateMilliseconds.reset();
+        stats.guiSetParentMilliseconds.reset();
+        stats.guiShowMilliseconds.reset();
+        stats.guiDestroyMilliseconds.reset();
+    }
 
-#define DO_TRACE 0
-#if DO_TRACE
-#define TRACE std::cout << FLF << std::endl;
-#define TRACEOUT(x) std::cout << FLF << x << std::endl;
-#define SZTRACE(x) dumpSizeDebugInfo(x, __func__, __LINE__);
+    static uint64_t residentBytes()
+    {
+#if JUCE_LINUX
+        long pages{0}, resident{0};
+        auto *f = std::fopen("/proc/self/statm", "r");
+        if (!f)
+            return 0;
+        if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        std::fclose(f);
+        return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#elif JUCE_MAC
+        mach_task_basic_info_data_t info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) !=
+            KERN_SUCCESS)
+            return 0;
+        return (uint64_t)info.resident_size;
 #else
-#define TRACE ;
-#define TRACEOUT(x) ;
-#define SZTRACE(x) ;
+        return 0;
 #endif
+    }
 
-namespace sst::clap_juce_shim
+  private:
+    std::mutex lock;
+    ClapJuceShim::LifecycleStats stats;
+};
+
+/*
+ * The workers shared by every tiled renderer, alive while any renderer is. Only
+ * touched from the message thread.
+ */
+struct TilePool
 {
-namespace details
+    static juce::ThreadPool *acquire()
+    {
+        if (users()++ == 0)
+        {
+            auto n = std::clamp(juce::SystemStats::getNumCpus() - 1, 1, 4);
+            pool() = std::make_unique<juce::ThreadPool>(n);
+        }
+        return pool().get();
+    }
+
+    static void release()
+    {
+        if (--users() == 0)
+            pool().reset();
+    }
+
+  private:
+    static std::unique_ptr<juce::ThreadPool> &pool()
+    {
+        static std::unique_ptr<juce::ThreadPool> p;
+        return p;
+    }
+    static int &users()
+    {
+        static int u{0};
+        return u;
+    }
+};
+
+/*
+ * Rasterises an editor which can paint from several threads at once. The invalid
+ * part of a cached image is cut into tiles, each painted into its own image by a
+ * worker (the message thread takes the first), and the tiles are copied into the
+ * cache once all are done. The cache is then drawn like JUCE's own buffered image.
+ * The message thread blocks meanwhile, so the editor must not need it to paint.
+ */
+struct TiledComponentImage : juce::CachedComponentImage
+{
+    static constexpr int tileSize{256};
+
+    explicit TiledComponentImage(juce::Component &c) : owner(c), pool(TilePool::acquire()) {}
+    ~TiledComponentImage() override { TilePool::release(); }
+
+    void paint(juce::Graphics &g) override
+    {
+        scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        auto compBounds = owner.getLocalBounds();
+        auto imageBounds = compBounds * scale;
+        if (imageBounds.isEmpty())
+            return;
+
+        auto fmt = owner.isOpaque() ? juce::Image::RGB : juce::Image::ARGB;
+        if (image.isNull() || image.getBounds() != imageBounds || image.getFormat() != fmt)
+        {
+            image = juce::Image(fmt, imageBounds.getWidth(), imageBounds.getHeight(),
+                                !owner.isOpaque(), juce::SoftwareImageType());
+            tileImages.clear();
+            valid.clear();
+        }
+
+        juce::RectangleList<int> dirty(image.getBounds());
+        dirty.subtract(valid);
+        if (!dirty.isEmpty())
+        {
+            render(dirty);
+            valid = juce::RectangleList<int>(image.getBounds());
+        }
+
+        g.setColour(juce::Colours::black.withAlpha(owner.getAlpha()));
+        g.drawImageTransformed(
+            image,
+            juce::AffineTransform::scale((float)compBounds.getWidth() / imageBounds.getWidth(),
+                                         (float)compBounds.getHeight() / imageBounds.getHeight()),
+            false);
+    }
+
+    bool invalidateAll() override
+    {
+        valid.clear();
+        return true;
+    }
+
+    bool invalidate(const juce::Rectangle<int> &area) override
+    {
+        valid.subtract((area.toFloat() * scale).getSmallestIntegerContainer());
+        return true;
+    }
+
+    void releaseResources() override
+    {
+        image = {};
+        tileImages.clear();
+        valid.clear();
+    }
+
+  private:
+    void render(const juce::RectangleList<int> &dirty)
+    {
+        tiles.clearQuick();
+        for (auto &r : dirty)
+            for (int y = r.getY(); y < r.getBottom(); y += tileSize)
+                for (int x = r.getX(); x < r.getRight(); x += tileSize)
+                    tiles.add(juce::Rectangle<int>(x, y, tileSize, tileSize).getIntersection(r));
+
+        while (tileImages.size() < (size_t)tiles.size())
+            tileImages.emplace_back(image.getFormat(), tileSize, tileSize, true,
+                                    juce::SoftwareImageType());
+
+        remaining = tiles.size();
+        for (int i = 1; i < tiles.size(); ++i)
+            pool->addJob([this, i]() { renderTile(i); });
+        renderTile(0);
+        done.wait();
+
+        for (int i = 0; i < tiles.size(); ++i)
+        {
+            auto t = tiles[i];
+            juce::Image::BitmapData src(tileImages[(size_t)i], 0, 0, t.getWidth(), t.getHeight(),
+                                        juce::Image::BitmapData::readOnly);
+            juce::Image::BitmapData dst(image, t.getX(), t.getY(), t.getWidth(), t.getHeight(),
+                                        juce::Image::BitmapData::writeOnly);
+            for (int y = 0; y < t.getHeight(); ++y)
+                memcpy(dst.getLinePointer(y), src.getLinePointer(y),
+                       (size_t)t.getWidth() * (size_t)dst.pixelStride);
+        }
+    }
+
+    void renderTile(int i)
+    {
+        auto t = tiles[i];
+        auto &img = tileImages[(size_t)i];
+        if (!owner.isOpaque())
+            img.clear({0, 0, t.getWidth(), t.getHeight()});
+
+        {
+            juce::Graphics tg(img);
+            tg.reduceClipRegion(0, 0, t.getWidth(), t.getHeight());
+            tg.addTransform(
+                juce::AffineTransform::scale(scale).translated((float)-t.getX(), (float)-t.getY()));
+            owner.paintEntireComponent(tg, true);
+        }
+
+        if (--remaining == 0)
+            done.signal();
+    }
+
+    juce::Component &owner;
+    juce::ThreadPool *pool;
+    float scale{1.f};
+    juce::Image image;
+    juce::RectangleList<int> valid;
+    juce::Array<juce::Rectangle<int>> tiles;
+    std::vector<juce::Image> tileImages;
+    std::atomic<int> remaining{0};
+    juce::WaitableEvent done;
+};
+
+/*
+ * Frame timing for one editor. A frame runs from the first paint hook JUCE reaches,
+ * the desktop's paint or the holder's cached image, to the end of the desktop's
+ * paintOverChildren, so it covers everything JUCE painted for that repaint. The
+ * dirty area is the bounding box of the clip, and a top level child of the editor
+ * counts as repainted if it intersects it. Off unless enabled.
+ */
+struct FrameInstrumentation : juce::Timer
 {
+    bool enabled{false}, overlayVisible{false};
+    Histogram frameMilliseconds, dirtyPixels, pumpMilliseconds, pumpMessages;
+    std::map<std::string, uint64_t> subtreeRepaints;
+    juce::Component *desktop{nullptr};
+
+    double frameStart{-1};
+
+    static juce::Rectangle<int> overlayBounds() { return {8, 8, 240, 54}; }
+
+    void setOverlayVisible(bool b)
+    {
+        overlayVisible = b;
+        if (b)
+            startTimerHz(4);
+        else
+            stopTimer();
+        if (desktop)
+            desktop->repaint(overlayBounds());
+    }
+
+    // The overlay refreshes itself, so its own repaints are not editor frames
+    void timerCallback() override
+    {
+        if (desktop)
+            desktop->repaint(overlayBounds());
+    }
+
+    // Either hook may be skipped by JUCE, so both call this and the first one counts
+    void frameBegin()
+    {
+        if (enabled && frameStart < 0)
+            frameStart = juce::Time::getMillisecondCounterHiRes();
+    }
+
+    // paintOverChildren always runs, with the whole of the frame's clip
+    void frameEnd(juce::Graphics &g, juce::Component *editor)
+    {
+        auto frameClip = g.getClipBounds();
+        auto overlayOnly = overlayVisible && overlayBounds().contains(frameClip);
+        if (frameStart >= 0 && !overlayOnly)
+        {
+            frameMilliseconds.record(juce::Time::getMillisecondCounterHiRes() - frameStart);
+            dirtyPixels.record((double)frameClip.getWidth() * frameClip.getHeight());
+
+            if (editor && desktop)
+            {
+                for (int i = 0; i < editor->getNumChildComponents(); ++i)
+                {
+                    auto *c = editor->getChildComponent(i);
+                    if (!c->isVisible() ||
+                        !desktop->getLocalArea(c, c->getLocalBounds()).intersects(frameClip))
+                        continue;
+                    subtreeRepaints[subtreeName(c, i)]++;
+                }
+            }
+        }
+        frameStart = -1;
+
+        if (enabled && overlayVisible)
+            drawOverlay(g);
+    }
+
+    static std::string subtreeName(juce::Component *c, int idx)
+    {
+        if (c->getComponentID().isNotEmpty())
+            return c->getComponentID().toStdString();
+        if (c->getName().isNotEmpty())
+            return c->getName().toStdString();
+        return "child " + std::to_string(idx);
+    }
+
+    void drawOverlay(juce::Graphics &g)
+    {
+        auto r = overlayBounds();
+        g.setColour(juce::Colours::black.withAlpha(0.75f));
+        g.fillRect(r);
+        g.setColour(juce::Colours::white);
+        g.setFont(12.f);
+
+        auto ms = [](const Histogram &h, double p) { return juce::String(h.percentile(p), 2); };
+        auto line = r.reduced(4, 2).withHeight(16);
+        g.drawText("frame ms p50 " + ms(frameMilliseconds, 50) + " p95 " +
+                       ms(frameMilliseconds, 95) + " p99 " + ms(frameMilliseconds, 99),
+                   line, juce::Justification::centredLeft);
+        line.translate(0, 16);
+        g.drawText("frames " + juce::String(frameMilliseconds.count()) + " dirty px p50 " +
+                       juce::String((int64_t)dirtyPixels.percentile(50)),
+                   line, juce::Justification::centredLeft);
+        line.translate(0, 16);
+        g.drawText("pump ms p95 " + ms(pumpMilliseconds, 95) + " msgs p95 " +
+                       juce::String((int64_t)pumpMessages.percentile(95)),
+                   line, juce::Justification::centredLeft);
+    }
+
+    void reset()
+    {
+        frameMilliseconds.reset();
+        dirtyPixels.reset();
+        pumpMilliseconds.reset();
+        pumpMessages.reset();
+        subtreeRepaints.clear();
+    }
+};
+
 struct Implementor
 {
 #if JUCE_WINDOWS
@@ -58,12 +558,16 @@ struct Implementor
         bool rescaleChild;
         ImplParent(const std::string &nm, bool rsc) : displayName(nm), rescaleChild(rsc)
         {
-            TRACEOUT("Creating an impl parent " << displayName);
+            TRACE;
             setAccessible(true);
             setTitle("Implementation Parent " + displayName);
+
+            // We paint every pixel we are not covering with an opaque child, so JUCE can
+            // skip painting whatever is beneath us
+            setOpaque(true);
         }
 
-        ~ImplParent() { TRACEOUT("DESTROYING an impl parent"); }
+        ~ImplParent() { TRACE; }
 
         std::unique_ptr<juce::AccessibilityHandler> createAccessibilityHandler() override
         {
@@ -71,7 +575,69 @@ struct Implementor
                                                                 juce::AccessibilityRole::ignored);
         }
 
-        void paint(juce::Graphics &g) override { g.fillAll(juce::Colours::black); }
+        void paint(juce::Graphics &g) override
+        {
+            if (onPaint)
+                onPaint(g);
+            fillUncovered(g);
+        }
+
+        /*
+         * Only fill what an opaque child leaves uncovered, which is usually nothing or
+         * a letterbox. JUCE clips opaque children out itself, but not transformed ones,
+         * so do it here. A transformed child's bounds are rounded outwards, so trim
+         * them by a pixel rather than risk leaving a gap unpainted.
+         */
+        void fillUncovered(juce::Graphics &g)
+        {
+            auto clip = g.getClipBounds();
+            juce::RectangleList<int> uncovered(clip);
+            if (getNumChildComponents() == 1)
+            {
+                auto *c = getChildComponent(0);
+                if (c->isVisible() && c->isOpaque() && c->getAlpha() >= 1.f)
+                    uncovered.subtract(c->getBoundsInParent().reduced(c->isTransformed() ? 1 : 0));
+            }
+
+            auto area = [](const juce::RectangleList<int> &rl) {
+                uint64_t res{0};
+                for (auto &r : rl)
+                    res += (uint64_t)r.getWidth() * r.getHeight();
+                return res;
+            };
+            filledThisPaint += area(uncovered);
+
+            if (!uncovered.isEmpty())
+            {
+                g.setColour(juce::Colours::black);
+                g.fillRectList(uncovered);
+            }
+        }
+        uint64_t pixelsFilled{0}, pixelsSkipped{0}, filledThisPaint{0};
+
+        /*
+         * JUCE skips paint() entirely when opaque children cover the clip, but always
+         * calls this with the clip restored, so the accounting happens here. Whatever
+         * of the clip paint() did not fill was skipped.
+         */
+        void paintOverChildren(juce::Graphics &g) override
+        {
+            auto clip = g.getClipBounds();
+            auto clipArea = (uint64_t)clip.getWidth() * clip.getHeight();
+            auto filled = std::min(filledThisPaint, clipArea);
+            pixelsFilled += filled;
+            pixelsSkipped += clipArea - filled;
+            filledThisPaint = 0;
+
+            if (onPaintOverChildren)
+                onPaintOverChildren(g);
+        }
+
+        // Keys the editor did not use bubble up to here
+        bool keyPressed(const juce::KeyPress &k) override
+        {
+            return onKeyPressed && onKeyPressed(k);
+        }
 
         void resized() override
         {
@@ -82,136 +648,1048 @@ struct Implementor
                 auto w = getLocalBounds().getWidth();
                 auto h = getLocalBounds().getHeight();
 
-                TRACEOUT("pre - w/h = " << w << " " << h << " " << displayName << " "
-                                        << rescaleChild);
+                // As we go downwards we unwind the transform
+                getTransform().inverted().transformPoint(w, h);
+                if (rescaleChild)
+                    getChildComponent(0)->getTransform().inverted().transformPoint(w, h);
+                trace::instant("ImplParent::resized", "size", {"w", w}, {"h", h},
+                               {"rescaleChild", rescaleChild});
+
+                getChildComponent(0)->setBounds(0, 0, w, h);
+            }
+
+            if (onResized)
+                onResized();
+        }
+
+        std::function<void()> onResized;
+        std::function<void(juce::Graphics &)> onPaint, onPaintOverChildren;
+        std::function<bool(const juce::KeyPress &)> onKeyPressed;
+
+        void visibilityChanged() override { TRACE; }
+        void parentHierarchyChanged() override { TRACE; }
+    };
+
+    /*
+     * JUCE skips paint() on a component whose opaque children cover the clip, which
+     * the editor nearly always does, but asks a child's cached image to paint whenever
+     * the child is in the clip. This one sits on the holder and passes straight
+     * through, so it sees the start of every paint that reaches the editor.
+     */
+    struct PaintStartHook : juce::CachedComponentImage
+    {
+        PaintStartHook(juce::Component &c, std::function<void(juce::Graphics &)> f)
+            : owner(c), onStart(std::move(f))
+        {
+        }
+
+        // The trace scope brackets the holder and the editor it contains
+        void paint(juce::Graphics &g) override
+        {
+            onStart(g);
+            trace::Scope paintScope("paint", "paint", {"w", owner.getWidth()},
+                                    {"h", owner.getHeight()});
+            owner.paintEntireComponent(g, false);
+        }
+        bool invalidateAll() override { return true; }
+        bool invalidate(const juce::Rectangle<int> &) override { return true; }
+        void releaseResources() override {}
+
+        juce::Component &owner;
+        std::function<void(juce::Graphics &)> onStart;
+    };
+
+    const clap_window *guiParentWindow{nullptr};
+    bool guiParentAttached{false};
+    void guaranteeSetup()
+    {
+        TRACE;
+        if (!holdsGuiLease)
+        {
+            JuceGuiLifetime::acquire();
+            holdsGuiLease = true;
+        }
+    }
+
+#if JUCE_LINUX
+    void guaranteeMessageThread()
+    {
+        if (!holdsMessageThread)
+        {
+            DedicatedMessageThread::acquire();
+            holdsMessageThread = true;
+        }
+    }
+
+    // Off the message thread, which this may stop
+    void releaseMessageThread()
+    {
+        if (holdsMessageThread)
+        {
+            DedicatedMessageThread::release();
+            holdsMessageThread = false;
+        }
+    }
+#endif
+
+    // Off the message thread, once the editor is gone, as this may shut JUCE down
+    void releaseGuiLease()
+    {
+        if (holdsGuiLease)
+        {
+            JuceGuiLifetime::release();
+            holdsGuiLease = false;
+        }
+    }
+
+    ~Implementor();
+
+    void releaseResources()
+    {
+        // The components have to go before JUCE might shut down, and on the thread
+        // which owns them
+        runOnMessageThread([this]() {
+            paramDrainTimer.stopTimer();
+            wheelTimer.stopTimer();
+            instrumentation.stopTimer();
+            instrumentation.desktop = nullptr;
+            incrementalBuild.reset();
+            if (implDesktop)
+                Lifecycle::get().editorGone();
+            editor.reset();
+            implHolder.reset();
+            implDesktop.reset();
+        });
+#if JUCE_LINUX
+        releaseMessageThread();
+#endif
+        releaseGuiLease();
+    }
+
+    void setContents(std::unique_ptr<juce::Component> &c)
+    {
+        jassert(!editor);
+        jassert(!implDesktop);
+        editor = std::move(c);
+        implDesktop = std::make_unique<ImplParent>("Desktop", false);
+        Lifecycle::get().editorBorn();
+        implDesktop->onPaint = [this](juce::Graphics &) { paintStarted(); };
+        implDesktop->onPaintOverChildren = [this](juce::Graphics &g) {
+            instrumentation.frameEnd(g, editor.get());
+        };
+        implDesktop->onKeyPressed = [this](const juce::KeyPress &k) {
+            auto mods = juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier |
+                        juce::ModifierKeys::altModifier;
+            if (!instrumentation.enabled || k != juce::KeyPress('i', mods, 0))
+                return false;
+            instrumentation.setOverlayVisible(!instrumentation.overlayVisible);
+            return true;
+        };
+        // The desktop is what the host sizes, so this is in the same space as guiSetSize
+        implDesktop->onResized = [this]() {
+            if (onHostSizeChanged)
+                onHostSizeChanged(implDesktop->getWidth(), implDesktop->getHeight());
+        };
+        instrumentation.desktop = implDesktop.get();
+        instrumentation.setOverlayVisible(instrumentation.overlayVisible); // destroy stopped it
+        implHolder = std::make_unique<ImplParent>("Holder", true);
+        implHolder->setCachedComponentImage(
+            new PaintStartHook(*implHolder, [this](juce::Graphics &) { paintStarted(); }));
+        implDesktop->addAndMakeVisible(*implHolder);
+        implHolder->addAndMakeVisible(*editor);
+        implHolder->setSize(editor->getWidth(), editor->getHeight());
+        implDesktop->setSize(editor->getWidth(), editor->getHeight());
+        applyRenderMode();
+    }
+
+    // Stands in for the editor while an IncrementalEditorBuilder is working
+    struct Placeholder : juce::Component
+    {
+        Placeholder()
+        {
+            setTitle("Editor Placeholder");
+            setOpaque(true);
+        }
+        void paint(juce::Graphics &g) override { g.fillAll(juce::Colours::black); }
+    };
+
+    /*
+     * Drives an IncrementalEditorBuilder from the message loop. On linux juce timers
+     * are dispatched by the pump, so this steps once per pump tick.
+     */
+    struct IncrementalBuild : juce::Timer
+    {
+        IncrementalBuild(Implementor &i, std::unique_ptr<IncrementalEditorBuilder> b, double ms,
+                         std::function<void(uint32_t)> done)
+            : impl(i), builder(std::move(b)), budgetMs(ms), onDone(std::move(done))
+        {
+            startTimer(1);
+        }
+
+        void timerCallback() override
+        {
+            steps++;
+            if (!builder->step(budgetMs))
+                return;
+
+            stopTimer();
+            auto ed = builder->takeEditor();
+            if (ed)
+                impl.swapEditor(ed);
+            if (onDone)
+                onDone(steps);
+        }
+
+        Implementor &impl;
+        std::unique_ptr<IncrementalEditorBuilder> builder;
+        double budgetMs;
+        std::function<void(uint32_t)> onDone;
+        uint32_t steps{0};
+    };
+    std::unique_ptr<IncrementalBuild> incrementalBuild;
+    std::function<void()> onFirstPaint;
+
+    // From the desktop's paint and the holder's hook, so whichever JUCE runs
+    void paintStarted()
+    {
+        if (onFirstPaint)
+        {
+            onFirstPaint();
+            onFirstPaint = nullptr;
+        }
+        instrumentation.frameBegin();
+    }
+    FrameInstrumentation instrumentation;
+
+    struct CallbackTimer : juce::Timer
+    {
+        std::function<void()> onTick;
+        void timerCallback() override
+        {
+            if (onTick)
+                onTick();
+        }
+    };
+    // Where there is no host driven pump tick, these drain the audio to gui channel
+    // and run the timer wheel, the latter re-armed to its next deadline each time
+    CallbackTimer paramDrainTimer, wheelTimer;
+    bool wheelTimerEnabled{false};
+
+    void swapEditor(std::unique_ptr<juce::Component> &c)
+    {
+        jassert(implHolder && editor);
+        implHolder->removeChildComponent(editor.get());
+        editor = std::move(c);
+        implHolder->addAndMakeVisible(*editor);
+        implHolder->resized();
+        applyRenderMode();
+    }
+
+    // Leaves alone an editor which has set up its own cached image
+    bool tiledRendering{false};
+    void applyRenderMode()
+    {
+        if (!editor)
+            return;
+        auto *current = editor->getCachedComponentImage();
+        if (tiledRendering && !current)
+            editor->setCachedComponentImage(new TiledComponentImage(*editor));
+        else if (!tiledRendering && dynamic_cast<TiledComponentImage *>(current))
+            editor->setCachedComponentImage(nullptr);
+    }
+
+    // Tears the editor down whether or not it was ever parented or hibernated
+    void destroy()
+    {
+        TRACE;
+        incrementalBuild.reset();
+        resizeCoalescer.cancelPendingUpdate();
+        instrumentation.stopTimer();
+        guiParentAttached = false;
+        hibernating = false;
+        if (implDesktop)
+        {
+            implDesktop->removeAllChildren();
+            Lifecycle::get().editorGone();
+        }
+        editor.reset(nullptr);
+        implHolder.reset(nullptr);
+        implDesktop.reset(nullptr);
+        instrumentation.desktop = nullptr;
+    }
+
+    // Take the editor off its window but keep the hierarchy for the next guiCreate
+    void hibernate()
+    {
+        TRACE;
+        if (!implDesktop || !editor)
+            return;
+
+        guiParentAttached = false;
+        implDesktop->removeFromDesktop();
+        hibernating = true;
+    }
+
+    bool hibernating{false};
+    uint64_t hibernatedBytes{0};
+
+    // Called on the message thread after the hibernation budget discarded the editor
+    std::function<void()> onEvicted;
+
+    juce::Component *desktop() { return implDesktop.get(); }
+    juce::Component *edHolder() { return implHolder.get(); }
+    juce::Component *ed() { return editor.get(); }
+
+    // The fill accounting of both wrappers, summed
+    void getWrapperPixels(uint64_t &filled, uint64_t &skipped) const
+    {
+        for (auto *p : {implDesktop.get(), implHolder.get()})
+        {
+            if (p)
+            {
+                filled += p->pixelsFilled;
+                skipped += p->pixelsSkipped;
+            }
+        }
+    }
+
+    void resetWrapperPixels()
+    {
+        for (auto *p : {implDesktop.get(), implHolder.get()})
+            if (p)
+                p->pixelsFilled = p->pixelsSkipped = p->filledThisPaint = 0;
+    }
+
+    // Called on the message thread whenever the size reported to the host changes,
+    // in host pixels, which on windows are the editor's scaled by the gui scale
+    std::function<void(int, int)> onHostSizeChanged;
+
+    /*
+     * Hosts can send dozens of sizes per frame while dragging. Only the latest one
+     * is kept and it is applied from a single async update, so there is at most one
+     * layout pass per message loop iteration (per pump tick on linux).
+     */
+    struct ResizeCoalescer : juce::AsyncUpdater
+    {
+        std::function<void(int, int)> apply;
+
+        void request(int w, int h)
+        {
+            auto v = pendingBit | ((uint64_t)w << 32) | (uint32_t)h;
+            pending.store(v, std::memory_order_release);
+            triggerAsyncUpdate();
+        }
+
+        void handleAsyncUpdate() override
+        {
+            auto v = pending.exchange(0, std::memory_order_acq_rel);
+            if ((v & pendingBit) && apply)
+                apply((int)((v >> 32) & 0x7FFFFFFF), (int)(v & 0xFFFFFFFF));
+        }
+
+      private:
+        static constexpr uint64_t pendingBit{1ULL << 63};
+        std::atomic<uint64_t> pending{0};
+    } resizeCoalescer;
+
+    bool holdsGuiLease{false};
+#if JUCE_LINUX
+    bool holdsMessageThread{false};
+#endif
+
+  protected:
+    std::unique_ptr<ImplParent> implDesktop{nullptr}, implHolder{nullptr};
+    std::unique_ptr<juce::Component> editor{nullptr};
+};
+
+/*
+ * Hibernated editors from every shim in the process, most recently hibernated
+ * first. Past the budget the oldest ones are really destroyed. Everything here
+ * runs on the message thread.
+ */
+struct HibernationCache
+{
+    static HibernationCache &get()
+    {
+        static HibernationCache cache;
+        return cache;
+    }
+
+    void add(Implementor *impl, uint64_t bytes)
+    {
+        remove(impl);
+        impl->hibernatedBytes = bytes;
+        lru.push_front(impl);
+        totalBytes += bytes;
+        enforceBudget();
+    }
+
+    // Reclaim a hibernated editor for its shim. Returns false if it was evicted.
+    bool wake(Implementor *impl, bool countMiss)
+    {
+        if (impl->hibernating && remove(impl))
+        {
+            impl->hibernating = false;
+            stats.hits++;
+            return true;
+        }
+        if (countMiss)
+            stats.misses++;
+        return false;
+    }
+
+    bool remove(Implementor *impl)
+    {
+        auto it = std::find(lru.begin(), lru.end(), impl);
+        if (it == lru.end())
+            return false;
+        totalBytes -= impl->hibernatedBytes;
+        lru.erase(it);
+        return true;
+    }
+
+    void setBudget(const ClapJuceShim::HibernationBudget &b)
+    {
+        budget = b;
+        enforceBudget();
+    }
+
+    ClapJuceShim::HibernationStats getStats() const
+    {
+        auto res = stats;
+        res.hibernatingEditors = (uint32_t)lru.size();
+        res.hibernatingBytes = totalBytes;
+        return res;
+    }
+
+  private:
+    std::list<Implementor *> lru;
+    uint64_t totalBytes{0};
+    ClapJuceShim::HibernationBudget budget;
+    ClapJuceShim::HibernationStats stats;
+
+    void enforceBudget()
+    {
+        while (!lru.empty() && (lru.size() > budget.maxEditors ||
+                                (budget.maxBytes > 0 && totalBytes > budget.maxBytes)))
+        {
+            auto *victim = lru.back();
+            remove(victim);
+            victim->destroy();
+            stats.evictions++;
+            if (victim->onEvicted)
+                victim->onEvicted();
+        }
+    }
+};
+
+Implementor::~Implementor()
+{
+    runOnMessageThread([this]() { HibernationCache::get().remove(this); });
+    releaseResources();
+}
+} // namespace details
+
+#if SHIM_LINUX
+struct PosixFdSupport
+{
+    ClapJuceShim &shim;
+    PosixFdSupport(ClapJuceShim &s);
+    ~PosixFdSupport();
+
+    void registerFd(int fd, clap_posix_fd_flags_t flags)
+    {
+        shim.editorProvider->registerOrUnregisterPosixFd(fd, flags, true);
+    }
+    void unregisterFd(int fd) { shim.editorProvider->registerOrUnregisterPosixFd(fd, 0, false); }
+};
+
+namespace details
+{
+/*
+ * The JUCE event loop fds belong to the library, not to a plugin instance, so
+ * registering all of them with every instance's host means each readiness event
+ * gets dispatched once per open editor. The registry listens to JUCE once, keeps
+ * a count of the attached PosixFdSupports, and registers each fd through exactly
+ * one owner. When an owner goes away its fds move to a surviving instance.
+ */
+struct PosixFdRegistry : juce::LinuxEventLoopInternal::Listener
+{
+    static PosixFdRegistry &get()
+    {
+        static PosixFdRegistry registry;
+        return registry;
+    }
+
+    void attach(PosixFdSupport *s)
+    {
+        members.push_back(s);
+        if (members.size() == 1)
+            juce::LinuxEventLoopInternal::registerLinuxEventLoopListener(*this);
+
+        // The fds may have been opened before anyone was listening
+        registerMissing(juce::LinuxEventLoopInternal::getRegisteredFds());
+    }
+
+    void detach(PosixFdSupport *s)
+    {
+        members.erase(std::remove(members.begin(), members.end(), s), members.end());
+        if (members.empty())
+            juce::LinuxEventLoopInternal::deregisterLinuxEventLoopListener(*this);
+
+        for (auto it = owners.begin(); it != owners.end();)
+        {
+            if (it->second.owner != s)
+            {
+                ++it;
+                continue;
+            }
+
+            unregisterWithHost(it->second.owner, it->first);
+            if (members.empty())
+            {
+                it = owners.erase(it);
+            }
+            else
+            {
+                it->second.owner = members.front();
+                registerWithHost(it->second.owner, it->first, it->second.flags);
+                ++it;
+            }
+        }
+    }
+
+    bool isOwner(const PosixFdSupport *s, int fd) const
+    {
+        auto it = owners.find(fd);
+        return it != owners.end() && it->second.owner == s;
+    }
+
+    // Only touch the host for fds which actually came or went
+    void fdCallbacksChanged() override
+    {
+        auto current = juce::LinuxEventLoopInternal::getRegisteredFds();
+        std::sort(current.begin(), current.end());
+
+        for (auto it = owners.begin(); it != owners.end();)
+        {
+            if (std::binary_search(current.begin(), current.end(), it->first))
+            {
+                ++it;
+                continue;
+            }
+            unregisterWithHost(it->second.owner, it->first);
+            it = owners.erase(it);
+        }
+
+        registerMissing(current);
+    }
+
+    /*
+     * JUCE's run loop polls every fd it is handed for input only, so that is all
+     * we ask the host for. In particular we never ask for write readiness: an x11
+     * socket is writable nearly all the time and the host would spin waking us.
+     */
+    static clap_posix_fd_flags_t interestFlagsFor(int)
+    {
+        return CLAP_POSIX_FD_READ | CLAP_POSIX_FD_ERROR;
+    }
+
+    ClapJuceShim::PosixFdStats stats;
+
+  private:
+    struct Entry
+    {
+        PosixFdSupport *owner{nullptr};
+        clap_posix_fd_flags_t flags{0};
+    };
+    std::vector<PosixFdSupport *> members;
+    std::map<int, Entry> owners;
+
+    void registerMissing(const std::vector<int> &fds)
+    {
+        if (members.empty())
+            return;
+
+        for (auto f : fds)
+        {
+            if (owners.find(f) != owners.end())
+                continue;
+
+            auto e = Entry{members.front(), interestFlagsFor(f)};
+            registerWithHost(e.owner, f, e.flags);
+            owners[f] = e;
+        }
+    }
+
+    void registerWithHost(PosixFdSupport *s, int fd, clap_posix_fd_flags_t flags)
+    {
+        stats.hostRegistrations++;
+        s->registerFd(fd, flags);
+    }
+
+    void unregisterWithHost(PosixFdSupport *s, int fd)
+    {
+        stats.hostUnregistrations++;
+        s->unregisterFd(fd);
+    }
+};
+
+/*
+ * Every open editor has a host timer, but they all drain the same JUCE queue. The
+ * coordinator keeps the attached shims in order and lets only the first one, the
+ * leader, pump. The others fall back to the slow idle rate and only take over
+ * if the leader stops ticking, for instance because its host stopped its timers.
+ */
+struct PumpCoordinator
+{
+    static PumpCoordinator &get()
+    {
+        static PumpCoordinator coordinator;
+        return coordinator;
+    }
+
+    void attach(ClapJuceShim *s)
+    {
+        if (std::find(attached.begin(), attached.end(), s) != attached.end())
+            return;
+        attached.push_back(s);
+        if (attached.size() == 1)
+        {
+            lastPumpMs = juce::Time::getMillisecondCounterHiRes();
+            windowStartMs = lastPumpMs;
+        }
+    }
+
+    void detach(ClapJuceShim *s)
+    {
+        auto wasLeader = leader() == s;
+        attached.erase(std::remove(attached.begin(), attached.end(), s), attached.end());
+        if (wasLeader && leader())
+            leader()->requestFastIdle();
+    }
+
+    ClapJuceShim *leader() const { return attached.empty() ? nullptr : attached.front(); }
+
+    bool shouldPump(ClapJuceShim *s)
+    {
+        stats.hostTicks++;
+        if (!leader())
+            attach(s);
+        if (leader() == s)
+            return true;
+
+        auto stallMs = 3000.0 / std::max(leader()->getIdleTimerRates().minHz, 1U);
+        if (juce::Time::getMillisecondCounterHiRes() - lastPumpMs > stallMs)
+        {
+            attached.erase(std::remove(attached.begin(), attached.end(), s), attached.end());
+            attached.insert(attached.begin(), s);
+            stats.leaderChanges++;
+            return true;
+        }
+
+        stats.skippedTicks++;
+        return false;
+    }
+
+    // Returns true if there was anything to do
+    bool pump(const ClapJuceShim::PumpBudget &budget)
+    {
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        uint64_t dispatched{0};
+        bool drained{false};
+        while (true)
+        {
+            if (!juce::detail::dispatchNextMessageOnSystemQueue(true))
+            {
+                drained = true;
+                break;
+            }
+            dispatched++;
+
+            if (budget.maxDispatchesPerTick > 0 && dispatched >= budget.maxDispatchesPerTick)
+                break;
+            if (budget.maxMillisecondsPerTick > 0 &&
+                juce::Time::getMillisecondCounterHiRes() - start >= budget.maxMillisecondsPerTick)
+                break;
+        }
+
+        for (auto *s : attached)
+            s->deliverAudioToGuiUpdates();
+
+        const auto end = juce::Time::getMillisecondCounterHiRes();
+        if (auto *l = leader(); l && l->impl->instrumentation.enabled)
+        {
+            l->impl->instrumentation.pumpMilliseconds.record(end - start);
+            l->impl->instrumentation.pumpMessages.record((double)dispatched);
+        }
+        if (trace::enabled())
+        {
+            auto durUs = (end - start) * 1000.0;
+            trace::complete("pump", "pump", trace::nowMicroseconds() - durUs, durUs,
+                            {"dispatches", dispatched}, {"drained", drained});
+        }
+        stats.ticks++;
+        stats.dispatches += dispatched;
+        stats.pumpMilliseconds += end - start;
+
+        if (inBacklog)
+            backlogDispatches += dispatched;
+
+        if (!drained)
+        {
+            // Out of budget with work queued. Count what it takes to clear it from here.
+            stats.budgetExceeded++;
+            if (!inBacklog)
+            {
+                inBacklog = true;
+                backlogDispatches = 0;
+            }
+        }
+        else if (inBacklog)
+        {
+            inBacklog = false;
+            stats.lastBacklog = backlogDispatches;
+            stats.maxBacklog = std::max(stats.maxBacklog, backlogDispatches);
+        }
+
+        lastPumpMs = end;
+        windowTicks++;
+        windowPumpMs += end - start;
+        if (end - windowStartMs >= 1000.0)
+        {
+            auto secs = (end - windowStartMs) / 1000.0;
+            stats.ticksPerSecond = windowTicks / secs;
+            stats.pumpMillisecondsPerSecond = windowPumpMs / secs;
+            windowStartMs = end;
+            windowTicks = 0;
+            windowPumpMs = 0;
+        }
+
+        return dispatched > 0 || !drained;
+    }
+
+    ClapJuceShim::PumpStats getStats() const
+    {
+        auto res = stats;
+        res.attachedShims = (uint32_t)attached.size();
+        return res;
+    }
+
+  private:
+    std::vector<ClapJuceShim *> attached;
+    ClapJuceShim::PumpStats stats;
+    bool inBacklog{false};
+    uint64_t backlogDispatches{0};
+    double lastPumpMs{0}, windowStartMs{0}, windowPumpMs{0};
+    uint64_t windowTicks{0};
+};
+} // namespace details
+
+PosixFdSupport::PosixFdSupport(ClapJuceShim &s) : shim(s)
+{
+    details::PosixFdRegistry::get().attach(this);
+}
+
+PosixFdSupport::~PosixFdSupport() { details::PosixFdRegistry::get().detach(this); }
+#endif
+
+ClapJuceShim::ClapJuceShim(EditorProvider *ep) : editorProvider(ep)
+{
+    details::Lifecycle::get().shimBorn();
+    impl = std::make_unique<details::Implementor>();
+    impl->onHostSizeChanged = [this](int w, int h) { publishSize(w, h); };
+    impl->onEvicted = [this]() {
+        // As guiDestroy does without hibernation, since the callbacks most likely
+        // pointed into the editor which just went
+        timerWheel.cancelAll();
+        publishedSize.store(0, std::memory_order_release);
+    };
+    impl->resizeCoalescer.apply = [this](int w, int h) { applySize(w, h); };
+    impl->paramDrainTimer.onTick = [this]() { deliverAudioToGuiUpdates(); };
+    impl->wheelTimer.onTick = [this]() {
+        runTimerWheel();
+        rearmTimerWheel();
+    };
+}
+
+ClapJuceShim::~ClapJuceShim()
+{
+    /*
+     * The timers call back into this, and the wheel goes before impl does, so stop
+     * them all before any member is destroyed rather than leave it to releaseResources.
+     */
+    details::runOnMessageThread([this]() {
+        impl->wheelTimerEnabled = false;
+        impl->paramDrainTimer.stopTimer();
+        impl->wheelTimer.stopTimer();
+        timerWheel.cancelAll();
+    });
+#if JUCE_LINUX
+    details::PumpCoordinator::get().detach(this);
+#endif
+    details::Lifecycle::get().shimGone();
+}
+
+bool ClapJuceShim::isEditorAttached() { return impl->guiParentAttached; }
+
+bool ClapJuceShim::guiAdjustSize(uint32_t *w, uint32_t *h) noexcept
+{
+    if (hasSizeConstraints)
+        adjustSizeToConstraints(sizeConstraints, getGuiScale(), *w, *h);
+    return true;
+}
+
+void ClapJuceShim::updateSizeConstraints() noexcept
+{
+    auto c = EditorSizeConstraints();
+    hasSizeConstraints = editorProvider->getSizeConstraints(c);
+    sizeConstraints = c;
+}
+
+bool ClapJuceShim::guiSetSize(uint32_t width, uint32_t height) noexcept
+{
+    trace::Scope shimTraceScope("guiSetSize", "shim", {"w", width}, {"h", height});
+
+    if (!impl->desktop())
+        return false;
+
+    resizesRequested++;
+    auto uw = (int32_t)std::min(width, 0x7FFFFFFFU), uh = (int32_t)std::min(height, 0x7FFFFFFFU);
+
+    // Report the requested size straight away even if the layout happens later
+    publishSize(uw, uh);
+
+    if (coalesceResizes)
+    {
+        impl->resizeCoalescer.request(uw, uh);
+#if JUCE_LINUX
+        requestFastIdle();
+#endif
+        return true;
+    }
+
+    details::runOnMessageThread([this, uw, uh]() { applySize(uw, uh); });
+    return true;
+}
 
-                // As we go downwards we unwind the transform
-                getTransform().inverted().transformPoint(w, h);
+void ClapJuceShim::applySize(int w, int h)
+{
+    if (!impl->desktop())
+        return;
 
-                TRACEOUT("post - w/h = " << w << " " << h << " " << displayName << " "
-                                         << rescaleChild);
-                TRACEOUT(getChildComponent(0)->getTitle()
-                         << " xf=" << getChildComponent(0)->getTransform().getScaleFactor())
-                if (rescaleChild)
-                    getChildComponent(0)->getTransform().inverted().transformPoint(w, h);
-                TRACEOUT("postpost - w/h = " << w << " " << h << " " << displayName << " "
-                                             << rescaleChild);
+    traceSizes("applySize pre");
+    impl->desktop()->setSize(w, h);
+    resizesApplied++;
+    traceSizes("applySize post");
+}
 
-                getChildComponent(0)->setBounds(0, 0, w, h);
-            }
-        }
+void ClapJuceShim::deliverAudioToGuiUpdates() noexcept
+{
+    if (audioToGui.size() == 0)
+        return;
 
-        void visibilityChanged() override { TRACE; }
-        void parentHierarchyChanged() override { TRACE; }
-    };
+    auto &batch = audioToGui.drain();
+    if (!batch.empty())
+        editorProvider->onParamValuesFromAudio(batch.data(), batch.size());
+}
 
-    const clap_window *guiParentWindow{nullptr};
-    bool guiParentAttached{false};
-    void guaranteeSetup()
-    {
-        TRACE;
-        if (!guiInitializer)
+void ClapJuceShim::setMessageThreadTimersRunning(bool b) noexcept
+{
+    details::runOnMessageThread([this, b]() {
+        impl->wheelTimerEnabled = b;
+        if (b)
         {
-            guiInitializer = std::make_unique<juce::ScopedJuceInitialiser_GUI>();
+            impl->paramDrainTimer.startTimerHz(60);
+            rearmTimerWheel();
         }
-    }
-
-    void setContents(std::unique_ptr<juce::Component> &c)
-    {
-        jassert(!editor);
-        jassert(!implDesktop);
-        editor = std::move(c);
-        implDesktop = std::make_unique<ImplParent>("Desktop", false);
-        implHolder = std::make_unique<ImplParent>("Holder", true);
-        implDesktop->addAndMakeVisible(*implHolder);
-        implHolder->addAndMakeVisible(*editor);
-        implHolder->setSize(editor->getWidth(), editor->getHeight());
-        implDesktop->setSize(editor->getWidth(), editor->getHeight());
-    }
-
-    void destroy()
-    {
-        TRACE;
-        if (guiParentAttached && implDesktop && editor)
+        else
         {
-            guiParentAttached = false;
-            implDesktop->removeAllChildren();
-            editor.reset(nullptr);
-            implHolder.reset(nullptr);
-            implDesktop.reset(nullptr);
+            impl->paramDrainTimer.stopTimer();
+            impl->wheelTimer.stopTimer();
         }
-    }
+    });
+}
 
-    juce::Component *desktop() { return implDesktop.get(); }
-    juce::Component *edHolder() { return implHolder.get(); }
-    juce::Component *ed() { return editor.get(); }
+TimerWheel::Handle ClapJuceShim::scheduleTimer(double periodMs, TimerWheel::Callback cb,
+                                               double firstDelayMs)
+{
+    auto res = timerWheel.schedule(periodMs, std::move(cb), firstDelayMs);
+    rearmTimerWheel();
+    return res;
+}
 
-    std::unique_ptr<juce::ScopedJuceInitialiser_GUI> guiInitializer{
-        nullptr}; // todo deal with lifecycle
+TimerWheel::Handle ClapJuceShim::scheduleTimerOnce(double delayMs, TimerWheel::Callback cb)
+{
+    auto res = timerWheel.scheduleOnce(delayMs, std::move(cb));
+    rearmTimerWheel();
+    return res;
+}
 
-  protected:
-    std::unique_ptr<ImplParent> implDesktop{nullptr}, implHolder{nullptr};
-    std::unique_ptr<juce::Component> editor{nullptr};
-};
-} // namespace details
+void ClapJuceShim::cancelTimer(TimerWheel::Handle h)
+{
+    timerWheel.cancel(h);
+    rearmTimerWheel();
+}
 
-#if SHIM_LINUX
-struct PosixFdSupport : juce::LinuxEventLoopInternal::Listener
+ClapJuceShim::TimerStats ClapJuceShim::getTimerStats() const
 {
-    ClapJuceShim &shim;
-    PosixFdSupport(ClapJuceShim &s) : shim(s)
-    {
-        juce::LinuxEventLoopInternal::registerLinuxEventLoopListener(*this);
-    }
-    ~PosixFdSupport()
+    auto res = timerStats;
+    res.wheel = timerWheel.getStats();
+    return res;
+}
+
+/*
+ * Separate timers would each have woken for every callback, and a blind timer at
+ * the tightest interval would have woken every interval. Count both against what
+ * the wheel actually did.
+ */
+void ClapJuceShim::runTimerWheel() noexcept
+{
+    if (timerWheel.empty())
     {
-        juce::LinuxEventLoopInternal::deregisterLinuxEventLoopListener(*this);
-        unregisterFds();
+        lastTimerWakeMs = 0;
+        return;
     }
 
-    std::vector<int> fds;
-    void fdCallbacksChanged() override
+    auto now = juce::Time::getMillisecondCounterHiRes();
+    auto interval = timerWheel.shortestIntervalMilliseconds();
+    auto fired = timerWheel.advance();
+
+    timerStats.wakeups++;
+    if (fired > 1)
+        timerStats.wakeupsSaved += fired - 1;
+    if (lastTimerWakeMs > 0 && interval > 0)
     {
-        unregisterFds();
-        fds = juce::LinuxEventLoopInternal::getRegisteredFds();
-        for (auto &f : fds)
-        {
-            shim.editorProvider->registerOrUnregisterPosixFd(
-                f, CLAP_POSIX_FD_READ | CLAP_POSIX_FD_WRITE | CLAP_POSIX_FD_ERROR, true);
-        }
+        auto blind = (uint64_t)std::floor((now - lastTimerWakeMs) / interval);
+        if (blind > 1)
+            timerStats.wakeupsSaved += blind - 1;
     }
+    lastTimerWakeMs = now;
+}
 
-    void unregisterFds()
+void ClapJuceShim::rearmTimerWheel() noexcept
+{
+#if JUCE_LINUX
+    // The host timer is driving us, so make sure it runs fast enough
+    if (idleTimerHz != 0)
     {
-        for (auto &f : fds)
-        {
-            shim.editorProvider->registerOrUnregisterPosixFd(f, 0, false);
-        }
-        fds.clear();
+        setIdleTimerHz(std::max(idleTimerHz, timerWheelHz()));
+        return;
     }
-};
 #endif
+    if (!impl->wheelTimerEnabled)
+        return;
 
-ClapJuceShim::ClapJuceShim(EditorProvider *ep) : editorProvider(ep)
+    auto ms = timerWheel.millisecondsToNextDeadline();
+    if (ms < 0)
+        impl->wheelTimer.stopTimer();
+    else
+        impl->wheelTimer.startTimer(std::max(1, (int)std::ceil(ms)));
+}
+
+void ClapJuceShim::setHibernationBudget(const HibernationBudget &b) noexcept
 {
-    impl = std::make_unique<details::Implementor>();
+    details::runOnMessageThread([b]() { details::HibernationCache::get().setBudget(b); });
 }
 
-ClapJuceShim::~ClapJuceShim() {}
+ClapJuceShim::HibernationStats ClapJuceShim::getHibernationStats() noexcept
+{
+    return details::HibernationCache::get().getStats();
+}
 
-bool ClapJuceShim::isEditorAttached() { return impl->guiParentAttached; }
-bool ClapJuceShim::guiAdjustSize(uint32_t *w, uint32_t *h) noexcept { return true; }
+ClapJuceShim::LifecycleStats ClapJuceShim::getLifecycleStats() noexcept
+{
+    return details::Lifecycle::get().getStats();
+}
 
-bool ClapJuceShim::guiSetSize(uint32_t width, uint32_t height) noexcept
+void ClapJuceShim::resetLifecycleTimings() noexcept { details::Lifecycle::get().resetTimings(); }
+
+ClapJuceShim::ResizeStats ClapJuceShim::getResizeStats() const noexcept
 {
-    TRACEOUT(" W=" << width << " H=" << height)
+    return {resizesRequested.load(), resizesApplied.load()};
+}
 
-    SZTRACE("Pre guiSetSize");
-    auto uw = static_cast<int32_t>(width), uh = static_cast<int32_t>(height);
-    impl->desktop()->setSize(uw, uh);
+void ClapJuceShim::setInstrumentationEnabled(bool b)
+{
+    details::runOnMessageThread([this, b]() {
+        auto &in = impl->instrumentation;
+        in.enabled = b;
+        if (!b && in.overlayVisible)
+            in.setOverlayVisible(false);
+    });
+}
 
-    SZTRACE("Post guiSetSize");
-    return true;
+void ClapJuceShim::setInstrumentationOverlayVisible(bool b)
+{
+    details::runOnMessageThread([this, b]() {
+        impl->instrumentation.setOverlayVisible(b && impl->instrumentation.enabled);
+    });
+}
+
+void ClapJuceShim::setTiledRendering(bool b)
+{
+    auto tiled = b && editorProvider->editorSupportsParallelPaint();
+    details::runOnMessageThread([this, tiled]() {
+        impl->tiledRendering = tiled;
+        impl->applyRenderMode();
+    });
+}
+
+juce::Image ClapJuceShim::renderToImage(int width, int height, double scale)
+{
+    trace::Scope shimTraceScope("renderToImage", "shim", {"w", width}, {"h", height});
+
+    juce::Image res;
+    details::runOnMessageThread([this, width, height, scale, &res]() {
+        const juce::MessageManagerLock mmLock;
+        auto *ed = impl->ed();
+        if (!ed || scale <= 0)
+            return;
+
+        /*
+         * Paint the editor itself rather than the wrappers. Its size is in editor
+         * pixels already, and resizing it leaves the window and the size reported to
+         * the host alone.
+         */
+        auto oldW = ed->getWidth(), oldH = ed->getHeight();
+        auto w = width > 0 ? width : oldW;
+        auto h = height > 0 ? height : oldH;
+        ed->setSize(w, h);
+
+        auto iw = std::max(1, (int)std::ceil(w * scale));
+        auto ih = std::max(1, (int)std::ceil(h * scale));
+        res = juce::Image(juce::Image::ARGB, iw, ih, true, juce::SoftwareImageType());
+        {
+            juce::Graphics g(res);
+            g.addTransform(juce::AffineTransform::scale((float)scale));
+            ed->paintEntireComponent(g, true);
+        }
+
+        ed->setSize(oldW, oldH);
+    });
+    return res;
+}
+
+void ClapJuceShim::resetInstrumentation()
+{
+    impl->instrumentation.reset();
+    impl->resetWrapperPixels();
+}
+
+ClapJuceShim::Instrumentation ClapJuceShim::getInstrumentation() const
+{
+    auto &in = impl->instrumentation;
+    Instrumentation res;
+    res.frameMilliseconds = in.frameMilliseconds;
+    res.dirtyPixels = in.dirtyPixels;
+    res.pumpMilliseconds = in.pumpMilliseconds;
+    res.pumpMessages = in.pumpMessages;
+    res.subtreeRepaints.assign(in.subtreeRepaints.begin(), in.subtreeRepaints.end());
+    impl->getWrapperPixels(res.wrapperPixelsFilled, res.wrapperPixelsSkipped);
+    std::sort(res.subtreeRepaints.begin(), res.subtreeRepaints.end(),
+              [](const auto &a, const auto &b) { return a.second > b.second; });
+    return res;
 }
 
 bool ClapJuceShim::guiIsApiSupported(const char *api, bool isFloating) noexcept
@@ -230,38 +1708,114 @@ bool ClapJuceShim::guiIsApiSupported(const char *api, bool isFloating) noexcept
 bool ClapJuceShim::guiCreate(const char *api, bool isFloating) noexcept
 {
     TRACE;
+    details::Lifecycle::Timed timed(&LifecycleStats::guiCreateMilliseconds);
     impl->guaranteeSetup();
-
-    impl->guiInitializer = std::make_unique<juce::ScopedJuceInitialiser_GUI>();
     juce::ignoreUnused(api);
 
     // Should never happen
     if (isFloating)
         return false;
 
-    const juce::MessageManagerLock mmLock;
-    auto ed = editorProvider->createEditor();
-    impl->setContents(ed);
+    updateSizeConstraints();
 
 #if JUCE_LINUX
-    idleTimerId = 0;
-    editorProvider->registerOrUnregisterTimer(idleTimerId, 1000 / 50, true);
+    if (details::DedicatedMessageThread::enabled())
+    {
+        // JUCE drives itself from here on, so no host timer or fds are needed
+        impl->guaranteeMessageThread();
+        details::runOnMessageThread([this]() { createOrWakeEditor(); });
+        setMessageThreadTimersRunning(true);
+        return impl->desktop() != nullptr;
+    }
+#endif
 
-    posixFdSupport = std::make_unique<PosixFdSupport>(*this);
+    const juce::MessageManagerLock mmLock;
+    createOrWakeEditor();
+
+#if JUCE_LINUX
+    startHostPump();
+#else
+    setMessageThreadTimersRunning(true);
 #endif
 
     return impl->desktop() != nullptr;
 }
 
+void ClapJuceShim::createOrWakeEditor()
+{
+    if (details::HibernationCache::get().wake(impl.get(), hibernateOnDestroy))
+        return;
+
+    editorBuildStats = {};
+    auto start = juce::Time::getMillisecondCounterHiRes();
+    impl->onFirstPaint = [this, start]() {
+        editorBuildStats.timeToFirstFrameMs = juce::Time::getMillisecondCounterHiRes() - start;
+    };
+
+    auto builder = editorProvider->createIncrementalEditorBuilder();
+    if (!builder)
+    {
+        auto ed = editorProvider->createEditor();
+        impl->setContents(ed);
+        editorBuildStats.timeToInteractiveMs = juce::Time::getMillisecondCounterHiRes() - start;
+        return;
+    }
+
+    // Return to the host straight away with a placeholder at the final size
+    editorBuildStats.incremental = true;
+    uint32_t w{0}, h{0};
+    builder->getInitialSize(w, h);
+    std::unique_ptr<juce::Component> placeholder =
+        std::make_unique<details::Implementor::Placeholder>();
+    placeholder->setSize((int)w, (int)h);
+    impl->setContents(placeholder);
+
+    impl->incrementalBuild = std::make_unique<details::Implementor::IncrementalBuild>(
+        *impl, std::move(builder), incrementalBuildStepMs, [this, start](uint32_t steps) {
+            editorBuildStats.steps = steps;
+            editorBuildStats.timeToInteractiveMs =
+                juce::Time::getMillisecondCounterHiRes() - start;
+        });
+}
+
 void ClapJuceShim::guiDestroy() noexcept
 {
     TRACE;
+    details::Lifecycle::Timed timed(&LifecycleStats::guiDestroyMilliseconds);
 #if JUCE_LINUX
-    editorProvider->registerOrUnregisterTimer(idleTimerId, 0, false);
+    stopHostPump();
 #endif
+    setMessageThreadTimersRunning(false);
+    guiHidden = false;
 
-    impl->destroy();
+    if (hibernateOnDestroy && impl->desktop())
+    {
+        details::runOnMessageThread([this]() {
+            auto bytes = editorProvider->getHibernatedEditorMemoryEstimate();
+            if (bytes == 0)
+                bytes = (uint64_t)impl->desktop()->getWidth() * impl->desktop()->getHeight() * 4;
+            impl->hibernate();
+            details::HibernationCache::get().add(impl.get(), bytes);
+        });
+    }
+    else
+    {
+        // The callbacks most likely point into the editor
+        details::runOnMessageThread([this]() {
+            timerWheel.cancelAll();
+            impl->destroy();
+        });
+    }
     impl->guiParentAttached = false;
+    if (!impl->desktop())
+        publishedSize.store(0, std::memory_order_release);
+
+#if JUCE_LINUX
+    // A hibernated editor needs no message loop until it is woken
+    impl->releaseMessageThread();
+#endif
+    if (!impl->desktop())
+        impl->releaseGuiLease();
 
 #if JUCE_MAC
     extern bool guiCocoaDetach(const clap_window *);
@@ -273,9 +1827,10 @@ void ClapJuceShim::guiDestroy() noexcept
 
 bool ClapJuceShim::guiSetParent(const clap_window *window) noexcept
 {
-    TRACE;
-    TRACEOUT("Creating : GPA=" << impl->guiParentAttached << " GW=" << impl->guiParentWindow
-                               << " W=" << window);
+    trace::Scope shimTraceScope("guiSetParent", "shim",
+                                {"wasAttached", impl->guiParentAttached},
+                                {"sameWindow", window == impl->guiParentWindow});
+    details::Lifecycle::Timed timed(&LifecycleStats::guiSetParentMilliseconds);
 
     if (impl->guiParentAttached && window == impl->guiParentWindow)
     {
@@ -286,7 +1841,7 @@ bool ClapJuceShim::guiSetParent(const clap_window *window) noexcept
          * wrong and we won't have removed ourself. So at least remove ourselves
          * so when we reparent to our existing window we show.
          */
-        impl->desktop()->removeFromDesktop();
+        details::runOnMessageThread([this]() { impl->desktop()->removeFromDesktop(); });
     }
     impl->guiParentAttached = true;
     impl->guiParentWindow = window;
@@ -296,13 +1851,15 @@ bool ClapJuceShim::guiSetParent(const clap_window *window) noexcept
     impl->desktop()->repaint();
     return res;
 #elif JUCE_LINUX
-    const juce::MessageManagerLock mmLock;
-    impl->desktop()->setVisible(false);
-    impl->desktop()->addToDesktop(0, (void *)window->x11);
-    auto *display = juce::XWindowSystem::getInstance()->getDisplay();
-    juce::X11Symbols::getInstance()->xReparentWindow(
-        display, (Window)impl->desktop()->getWindowHandle(), window->x11, 0, 0);
-    impl->desktop()->setVisible(true);
+    details::runOnMessageThread([this, window]() {
+        const juce::MessageManagerLock mmLock;
+        impl->desktop()->setVisible(false);
+        impl->desktop()->addToDesktop(0, (void *)window->x11);
+        auto *display = juce::XWindowSystem::getInstance()->getDisplay();
+        juce::X11Symbols::getInstance()->xReparentWindow(
+            display, (Window)impl->desktop()->getWindowHandle(), window->x11, 0, 0);
+        impl->desktop()->setVisible(true);
+    });
     return true;
 
 #elif JUCE_WINDOWS
@@ -319,46 +1876,100 @@ bool ClapJuceShim::guiSetParent(const clap_window *window) noexcept
 }
 
 // Show doesn't really exist in JUCE per se. If there's an impl->desktop() and its attached
-// we are good.
+// we are good. Coming back from guiHide restarts what hiding stopped.
 bool ClapJuceShim::guiShow() noexcept
 {
     TRACE;
+    details::Lifecycle::Timed timed(&LifecycleStats::guiShowMilliseconds);
 #if JUCE_MAC || JUCE_LINUX || JUCE_WINDOWS
     if (impl->desktop())
     {
-        SZTRACE("Size at show");
+        if (guiHidden)
+        {
+            guiHidden = false;
+#if JUCE_LINUX
+            if (!details::DedicatedMessageThread::enabled())
+                startHostPump();
+            else
+                setMessageThreadTimersRunning(true);
+#else
+            setMessageThreadTimersRunning(true);
+#endif
+            details::runOnMessageThread([this]() {
+                const juce::MessageManagerLock mmLock;
+                impl->desktop()->setVisible(true);
+                impl->desktop()->repaint();
+            });
+            editorProvider->editorVisibilityChanged(true);
+        }
+        traceSizes("guiShow");
         return impl->guiParentAttached;
     }
 #endif
     return false;
 }
 
-bool ClapJuceShim::guiGetSize(uint32_t *width, uint32_t *height) noexcept
+/*
+ * A hidden editor should cost nothing. Its host timer and fds go away (another
+ * instance picks up the shared pump and fds if there is one), the desktop
+ * component goes invisible so repaints are dropped, and the provider is told so
+ * it can stop its own timers and animations.
+ */
+bool ClapJuceShim::guiHide() noexcept
 {
     TRACE;
-    const juce::MessageManagerLock mmLock;
-    if (impl->desktop())
-    {
-        auto b = impl->edHolder()->getBounds();
-
-        *width = (uint32_t)b.getWidth();
-        *height = (uint32_t)b.getHeight();
+    if (!impl->desktop())
+        return false;
+    if (guiHidden)
+        return true;
 
-        TRACEOUT(" W=" << *width << " H=" << *height);
+    guiHidden = true;
+#if JUCE_LINUX
+    stopHostPump();
+#endif
+    setMessageThreadTimersRunning(false);
+    details::runOnMessageThread([this]() {
+        const juce::MessageManagerLock mmLock;
+        impl->desktop()->setVisible(false);
+    });
+    editorProvider->editorVisibilityChanged(false);
+    return true;
+}
 
+// The size is published from the message thread as the hierarchy resizes, so
+// answering needs neither the message manager lock nor the component tree.
+bool ClapJuceShim::guiGetSize(uint32_t *width, uint32_t *height) noexcept
+{
+    TRACE;
+    if (getPublishedSize(*width, *height))
         return true;
-    }
-    else
-    {
-        *width = 1000;
-        *height = 800;
-    }
+
+    *width = 1000;
+    *height = 800;
     return false;
 }
 
+void ClapJuceShim::publishSize(int w, int h) noexcept
+{
+    auto uw = (uint64_t)std::clamp(w, 0, 0x7FFFFFFF), uh = (uint64_t)std::max(h, 0);
+    publishedSize.store(hasPublishedSizeBit | (uw << 32) | (uh & 0xFFFFFFFF),
+                        std::memory_order_release);
+}
+
+bool ClapJuceShim::getPublishedSize(uint32_t &w, uint32_t &h) const noexcept
+{
+    auto v = publishedSize.load(std::memory_order_acquire);
+    if (!(v & hasPublishedSizeBit))
+        return false;
+
+    w = (uint32_t)((v >> 32) & 0x7FFFFFFF);
+    h = (uint32_t)(v & 0xFFFFFFFF);
+    return true;
+}
+
 bool ClapJuceShim::guiSetScale(double scale) noexcept
 {
-    TRACEOUT(" scale=" << scale);
+    trace::instant("guiSetScale", "shim", {"scale", scale});
 
 #if JUCE_LINUX
     return false;
@@ -377,19 +1988,18 @@ bool ClapJuceShim::guiSetScale(double scale) noexcept
 #endif
 }
 
-void ClapJuceShim::dumpSizeDebugInfo(const std::string &pfx, const std::string &func, int line)
+void ClapJuceShim::traceSizes(const char *label)
 {
+    if (!trace::enabled() || !impl->desktop() || !impl->ed())
+        return;
+
     auto sf = [](const auto &tf) { return std::sqrt(std::abs(tf.getDeterminant())); };
-    std::cout << __FILE__ << ":" << line << " " << func << " " << pfx << "\n"
-              << "   guiScale=" << guiScale << "\n   Desk=("
-              << impl->desktop()->getBounds().toString()
-              << " / xf = " << sf(impl->desktop()->getTransform()) << ")\n   Hold=("
-              << impl->edHolder()->getBounds().toString()
-              << " / xf = " << sf(impl->edHolder()->getTransform()) << ")\n   HoldInParent=("
-              << impl->edHolder()->getBoundsInParent().toString() << ")\n   Ed=("
-              << impl->ed()->getBounds().toString() << " / xf = " << sf(impl->ed()->getTransform())
-              << ")\n   EdInParent=(" << impl->ed()->getBoundsInParent().toString() << ")"
-              << std::endl;
+    trace::instant(label, "size", {"desktopW", impl->desktop()->getWidth()},
+                   {"desktopH", impl->desktop()->getHeight()}, {"editorW", impl->ed()->getWidth()},
+                   {"editorH", impl->ed()->getHeight()});
+    trace::instant(label, "scale", {"guiScale", guiScale},
+                   {"holder", sf(impl->edHolder()->getTransform())},
+                   {"editor", sf(impl->ed()->getTransform())});
 }
 #if JUCE_LINUX
 void ClapJuceShim::onTimer(clap_id timerId) noexcept
@@ -397,20 +2007,160 @@ void ClapJuceShim::onTimer(clap_id timerId) noexcept
     if (timerId != idleTimerId)
         return;
 
-    juce::ScopedJuceInitialiser_GUI libraryInitialiser;
+    auto &coordinator = details::PumpCoordinator::get();
+    if (!coordinator.shouldPump(this))
+    {
+        // Another editor drains the queue. Just tick slowly in case it stops doing
+        // so, or as fast as our own timer wheel needs.
+        if (!timerWheel.empty())
+        {
+            const juce::MessageManagerLock mmLock;
+            runTimerWheel();
+        }
+        setIdleTimerHz(std::max(idleTimerRates.minHz, timerWheelHz()));
+        return;
+    }
+
     const juce::MessageManagerLock mmLock;
 
-    while (juce::detail::dispatchNextMessageOnSystemQueue(true))
+    auto active = coordinator.pump(pumpBudget);
+    runTimerWheel();
+    noteIdleActivity(active);
+}
+
+ClapJuceShim::PumpStats ClapJuceShim::getPumpStats() noexcept
+{
+    return details::PumpCoordinator::get().getStats();
+}
+
+void ClapJuceShim::startHostPump() noexcept
+{
+    // Whatever happened while we were away is still queued, so start out fast
+    lastActivityMs = juce::Time::getMillisecondCounterHiRes();
+    setIdleTimerHz(idleTimerRates.maxHz);
+    details::PumpCoordinator::get().attach(this);
+
+    posixFdSupport = std::make_unique<PosixFdSupport>(*this);
+}
+
+void ClapJuceShim::stopHostPump() noexcept
+{
+    details::PumpCoordinator::get().detach(this);
+    setIdleTimerHz(0);
+    posixFdSupport.reset();
+}
+
+void ClapJuceShim::setUseDedicatedMessageThread(bool b) noexcept
+{
+    details::DedicatedMessageThread::enabled() = b;
+}
+
+bool ClapJuceShim::getUseDedicatedMessageThread() noexcept
+{
+    return details::DedicatedMessageThread::enabled();
+}
+
+ClapJuceShim::PosixFdStats ClapJuceShim::getPosixFdStats() noexcept
+{
+    return details::PosixFdRegistry::get().stats;
+}
+
+void ClapJuceShim::setIdleTimerRates(const IdleTimerRates &r) noexcept
+{
+    idleTimerRates = r;
+    idleTimerRates.minHz = std::clamp(idleTimerRates.minHz, 1U, 1000U);
+    idleTimerRates.maxHz = std::clamp(idleTimerRates.maxHz, idleTimerRates.minHz, 1000U);
+
+    if (idleTimerHz != 0)
+        setIdleTimerHz(std::clamp(idleTimerHz, idleTimerRates.minHz, idleTimerRates.maxHz));
+}
+
+void ClapJuceShim::requestFastIdle() noexcept
+{
+    // Only the pumping editor's rate matters
+    auto *leader = details::PumpCoordinator::get().leader();
+    if (leader && leader != this)
+    {
+        leader->requestFastIdle();
+        return;
+    }
+
+    if (idleTimerHz != 0)
+        noteIdleActivity(true);
+}
+
+void ClapJuceShim::noteIdleActivity(bool active) noexcept
+{
+    auto now = juce::Time::getMillisecondCounterHiRes();
+    auto hz = idleTimerHz;
+    if (active)
+    {
+        lastActivityMs = now;
+        hz = idleTimerRates.maxHz;
+    }
+    else if (now - lastActivityMs > idleTimerRates.quietMilliseconds)
+    {
+        hz = idleTimerRates.minHz;
+    }
+    setIdleTimerHz(std::max(hz, timerWheelHz()));
+}
+
+/*
+ * Hosts take a fixed period, so re-registering for every deadline would cost more
+ * than it saves. Instead run fast enough that the tightest live interval fires at
+ * most half an interval late, stepping up from minHz in doublings so the rate only
+ * changes when the set of intervals does. Zero if the wheel is empty.
+ */
+uint32_t ClapJuceShim::timerWheelHz() const noexcept
+{
+    auto interval = timerWheel.shortestIntervalMilliseconds();
+    if (interval < 0)
+        return 0;
+
+    auto need = 2000.0 / std::max(interval, 1.0);
+    auto hz = idleTimerRates.minHz;
+    while (hz < need && hz < idleTimerRates.maxHz)
+        hz *= 2;
+    return std::min(hz, idleTimerRates.maxHz);
+}
+
+// Hosts only take a period at registration, so changing rate means re-registering.
+// Only do that when the rate actually changes. A rate of zero unregisters.
+void ClapJuceShim::setIdleTimerHz(uint32_t hz) noexcept
+{
+    if (hz == idleTimerHz)
+        return;
+
+    if (idleTimerHz != 0)
+        editorProvider->registerOrUnregisterTimer(idleTimerId, 0, false);
+
+    idleTimerHz = hz;
+    if (hz != 0)
     {
+        idleTimerId = 0;
+        editorProvider->registerOrUnregisterTimer(idleTimerId, std::max(1000 / (int)hz, 1), true);
     }
 }
 
 void ClapJuceShim::onPosixFd(int fd, clap_posix_fd_flags_t) noexcept
 {
-    juce::ScopedJuceInitialiser_GUI libraryInitialiser;
+    trace::Scope shimTraceScope("onPosixFd", "fd", {"fd", fd});
+    auto &registry = details::PosixFdRegistry::get();
+
+    // Some other instance dispatches this fd now; this is a stale callback
+    if (!posixFdSupport || !registry.isOwner(posixFdSupport.get(), fd))
+    {
+        registry.stats.staleWakeups++;
+        return;
+    }
+    registry.stats.wakeups++;
+
     const juce::MessageManagerLock mmLock;
 
     juce::LinuxEventLoopInternal::invokeEventLoopCallbackForFd(fd);
+
+    // An x event usually means repaints or input handling are about to be queued
+    requestFastIdle();
 }
 
 #endif
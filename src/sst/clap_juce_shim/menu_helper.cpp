@@ -17,21 +17,17 @@
 #include "sst/clap_juce_shim/menu_helper.h"
 
 #include "clap/ext/context-menu.h"
-#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 namespace sst::clap_juce_shim
 {
 
-struct mhCtx
-{
-    std::deque<juce::PopupMenu *> menus;
-    std::deque<std::string> menuNames;
-    const clap_host_t *host{nullptr};
-    clap_id parId{0};
-    bool firstTime{true};
-    mhCtx(juce::PopupMenu &p) { menus.push_back(&p); };
-};
-
 const clap_host_context_menu_t *mhGetExt(const clap_host_t *host)
 {
     auto ext = host->get_extension(host, CLAP_EXT_CONTEXT_MENU);
@@ -46,92 +42,432 @@ const clap_host_context_menu_t *mhGetExt(const clap_host_t *host)
     return static_cast<const clap_host_context_menu_t *>(ext);
 }
 
-bool mhAddItem(const struct clap_context_menu_builder *builder,
-               clap_context_menu_item_kind_t item_kind, const void *item_data)
+clap_context_menu_target mhParamTarget(clap_id paramId)
+{
+    clap_context_menu_target t;
+    t.kind = CLAP_CONTEXT_MENU_TARGET_KIND_PARAM;
+    t.id = paramId;
+    return t;
+}
+
+clap_context_menu_target mhGlobalTarget()
+{
+    clap_context_menu_target t;
+    t.kind = CLAP_CONTEXT_MENU_TARGET_KIND_GLOBAL;
+    t.id = 0;
+    return t;
+}
+
+// One item as the host added it. Menus are built from a flat list of these.
+struct mhItem
+{
+    clap_context_menu_item_kind_t kind;
+    std::string label;
+    bool isEnabled{true};
+    bool isChecked{false};
+    clap_id actionId{0};
+};
+
+/*
+ * Menus the host populated, keyed by host and target. Like the menus themselves it
+ * is only touched from the message thread.
+ */
+struct mhCache
+{
+    using key_t = std::tuple<uintptr_t, uint32_t, clap_id>;
+    struct Entry
+    {
+        std::vector<mhItem> items;
+        double builtAtMs{0};
+    };
+
+    static mhCache &get()
+    {
+        static mhCache res;
+        return res;
+    }
+
+    static key_t keyFor(const clap_host_t *host, const clap_context_menu_target &t)
+    {
+        return {(uintptr_t)host, t.kind, t.id};
+    }
+
+    // Null if there is no entry or it has outlived the time to live
+    Entry *find(const key_t &k)
+    {
+        auto it = entries.find(k);
+        if (it == entries.end())
+            return nullptr;
+        auto ageMs = juce::Time::getMillisecondCounterHiRes() - it->second.builtAtMs;
+        if (policy.timeToLiveSeconds > 0 && ageMs > policy.timeToLiveSeconds * 1000.0)
+            return nullptr;
+        return &it->second;
+    }
+
+    Entry *refresh(const clap_host_t *host, const clap_context_menu_target &t);
+
+    void eraseHost(const clap_host_t *host)
+    {
+        auto matches = [h = (uintptr_t)host](const key_t &k) { return std::get<0>(k) == h; };
+        std::erase_if(entries, [&](const auto &e) { return matches(e.first); });
+        std::erase_if(pendingPrefetches, matches);
+    }
+
+    ClapMenuCachePolicy policy;
+    std::map<key_t, Entry> entries;
+    std::set<key_t> pendingPrefetches;
+};
+
+/*
+ * What the entries of one menu need to perform their action, built once and shared
+ * by all of them, so it lives exactly as long as the menu does. With one target the
+ * action is the host's action id. A merged menu numbers its entries instead and ids
+ * holds a row per entry of the action id each target gave it.
+ */
+struct mhActions
+{
+    const clap_host_t *host{nullptr};
+    const clap_host_context_menu_t *ext{nullptr};
+    std::vector<clap_context_menu_target> targets;
+    std::vector<clap_id> ids;
+
+    void perform(clap_id action) const
+    {
+        auto &cache = mhCache::get();
+        for (size_t i = 0; i < targets.size(); ++i)
+        {
+            auto id = ids.empty() ? action : ids[action * targets.size() + i];
+            // Performing an action may well change what the host would show next time
+            cache.entries.erase(mhCache::keyFor(host, targets[i]));
+            ext->perform(host, &targets[i], id);
+        }
+    }
+};
+
+/*
+ * Adds items to a juce menu as they come, either from the host's builder calls or
+ * from a recorded list. Open submenus are filled in place on a stack and moved into
+ * their parent when they end, and a separator goes in ahead of the first item.
+ */
+struct mhMenuBuilder
 {
-    auto mhc = static_cast<mhCtx *>(builder->ctx);
-    if (mhc->firstTime)
+    mhMenuBuilder(juce::PopupMenu &m, std::shared_ptr<const mhActions> a)
+        : root(m), actions(std::move(a))
     {
-        mhc->menus.back()->addSeparator();
-        mhc->firstTime = false;
     }
-    auto &currm = mhc->menus.back();
+    ~mhMenuBuilder()
+    {
+        // Close whatever the host left open
+        while (!open.empty())
+            endSubmenu();
+    }
+
+    void add(clap_context_menu_item_kind_t kind, const char *label, bool isEnabled,
+             bool isChecked, clap_id actionId)
+    {
+        if (!started)
+        {
+            root.addSeparator();
+            started = true;
+        }
+
+        switch (kind)
+        {
+        case CLAP_CONTEXT_MENU_ITEM_ENTRY:
+        case CLAP_CONTEXT_MENU_ITEM_CHECK_ENTRY:
+            current().addItem(juce::CharPointer_UTF8(label ? label : ""), isEnabled, isChecked,
+                              [a = actions, actionId]() { a->perform(actionId); });
+            break;
+        case CLAP_CONTEXT_MENU_ITEM_SEPARATOR:
+            current().addSeparator();
+            break;
+        case CLAP_CONTEXT_MENU_ITEM_BEGIN_SUBMENU:
+            open.push_back({juce::PopupMenu(), juce::CharPointer_UTF8(label ? label : ""),
+                            isEnabled});
+            break;
+        case CLAP_CONTEXT_MENU_ITEM_END_SUBMENU:
+            // An unbalanced end at the top level is ignored
+            if (!open.empty())
+                endSubmenu();
+            break;
+        case CLAP_CONTEXT_MENU_ITEM_TITLE:
+            current().addSectionHeader(juce::CharPointer_UTF8(label ? label : ""));
+            break;
+        default:
+            break;
+        }
+    }
+
+  private:
+    struct Submenu
+    {
+        juce::PopupMenu menu;
+        juce::String label;
+        bool isEnabled{true};
+    };
+
+    juce::PopupMenu &current() { return open.empty() ? root : open.back().menu; }
+
+    void endSubmenu()
+    {
+        auto sub = std::move(open.back());
+        open.pop_back();
+        // A merge can leave a submenu with nothing in it
+        if (sub.menu.getNumItems() > 0)
+            current().addSubMenu(sub.label, std::move(sub.menu), sub.isEnabled);
+    }
+
+    juce::PopupMenu &root;
+    std::shared_ptr<const mhActions> actions;
+    bool started{false};
+    std::vector<Submenu> open;
+};
+
+// Returns true if the menu builder supports the given item kind
+bool mhSupports(const struct clap_context_menu_builder *builder,
+                clap_context_menu_item_kind_t item_kind)
+{
+    return true;
+}
+
+bool mhRecordItem(const struct clap_context_menu_builder *builder,
+                  clap_context_menu_item_kind_t item_kind, const void *item_data)
+{
+    auto items = static_cast<std::vector<mhItem> *>(builder->ctx);
+    auto &i = items->emplace_back();
+    i.kind = item_kind;
+    auto str = [](const char *c) { return std::string(c ? c : ""); };
     switch (item_kind)
     {
     case CLAP_CONTEXT_MENU_ITEM_ENTRY:
     {
         auto it = static_cast<const clap_context_menu_entry_t *>(item_data);
-        currm->addItem(it->label, it->is_enabled, false,
-                       [paramId = mhc->parId, host = mhc->host, id = it->action_id]() {
-                           auto ext = mhGetExt(host);
-                           if (ext)
-                           {
-                               clap_context_menu_target t;
-                               t.kind = CLAP_CONTEXT_MENU_TARGET_KIND_PARAM;
-                               t.id = paramId;
-                               ext->perform(host, &t, id);
-                           }
-                       });
+        i.label = str(it->label);
+        i.isEnabled = it->is_enabled;
+        i.actionId = it->action_id;
     }
     break;
     case CLAP_CONTEXT_MENU_ITEM_CHECK_ENTRY:
     {
         auto it = static_cast<const clap_context_menu_check_entry_t *>(item_data);
-        currm->addItem(juce::CharPointer_UTF8(it->label), it->is_enabled, it->is_checked,
-                       [paramId = mhc->parId, host = mhc->host, id = it->action_id]() {
-                           auto ext = mhGetExt(host);
-                           if (ext)
-                           {
-                               clap_context_menu_target t;
-                               t.kind = CLAP_CONTEXT_MENU_TARGET_KIND_PARAM;
-                               t.id = paramId;
-                               ext->perform(host, &t, id);
-                           }
-                       });
+        i.label = str(it->label);
+        i.isEnabled = it->is_enabled;
+        i.isChecked = it->is_checked;
+        i.actionId = it->action_id;
+    }
+    break;
+    case CLAP_CONTEXT_MENU_ITEM_BEGIN_SUBMENU:
+    {
+        auto it = static_cast<const clap_context_menu_submenu_t *>(item_data);
+        i.label = str(it->label);
+        i.isEnabled = it->is_enabled;
     }
     break;
-    case CLAP_CONTEXT_MENU_ITEM_SEPARATOR:
+    case CLAP_CONTEXT_MENU_ITEM_TITLE:
     {
+        auto it = static_cast<const clap_context_menu_item_title_t *>(item_data);
+        i.label = str(it->title);
+        i.isEnabled = it->is_enabled;
+    }
+    break;
+    default:
+        break;
+    }
+    return true;
+}
 
-        currm->addSeparator();
+// Streams the host's items straight into a juce menu, copying no labels on the way
+bool mhBuildItem(const struct clap_context_menu_builder *builder,
+                 clap_context_menu_item_kind_t item_kind, const void *item_data)
+{
+    auto mb = static_cast<mhMenuBuilder *>(builder->ctx);
+    switch (item_kind)
+    {
+    case CLAP_CONTEXT_MENU_ITEM_ENTRY:
+    {
+        auto it = static_cast<const clap_context_menu_entry_t *>(item_data);
+        mb->add(item_kind, it->label, it->is_enabled, false, it->action_id);
     }
     break;
-    case CLAP_CONTEXT_MENU_ITEM_BEGIN_SUBMENU:
+    case CLAP_CONTEXT_MENU_ITEM_CHECK_ENTRY:
     {
-        auto it = static_cast<const clap_context_menu_submenu_t *>(item_data);
-        mhc->menuNames.push_back(it->label);
-        mhc->menus.push_back(new juce::PopupMenu());
+        auto it = static_cast<const clap_context_menu_check_entry_t *>(item_data);
+        mb->add(item_kind, it->label, it->is_enabled, it->is_checked, it->action_id);
     }
     break;
-    case CLAP_CONTEXT_MENU_ITEM_END_SUBMENU:
+    case CLAP_CONTEXT_MENU_ITEM_BEGIN_SUBMENU:
     {
-        auto mn = mhc->menus.back();
-        auto mnm = mhc->menuNames.back();
-
-        mhc->menus.pop_back();
-        mhc->menuNames.pop_back();
-
-        mhc->menus.back()->addSubMenu(mnm, *mn);
-        delete mn;
+        auto it = static_cast<const clap_context_menu_submenu_t *>(item_data);
+        mb->add(item_kind, it->label, it->is_enabled, false, 0);
     }
     break;
-
     case CLAP_CONTEXT_MENU_ITEM_TITLE:
     {
         auto it = static_cast<const clap_context_menu_item_title_t *>(item_data);
-
-        currm->addSectionHeader(it->title); // , it->is_enabled);
+        mb->add(item_kind, it->title, it->is_enabled, false, 0);
     }
     break;
+    default:
+        mb->add(item_kind, nullptr, true, false, 0);
+        break;
     }
     return true;
 }
 
-// Returns true if the menu builder supports the given item kind
-bool mhSupports(const struct clap_context_menu_builder *builder,
-                clap_context_menu_item_kind_t item_kind)
+void mhPopulate(const clap_host_t *host, const clap_host_context_menu_t *ext,
+                const clap_context_menu_target &t, std::vector<mhItem> &items)
 {
-    return true;
+    clap_context_menu_builder b;
+    b.ctx = &items;
+    b.add_item = mhRecordItem;
+    b.supports = mhSupports;
+    ext->populate(host, &t, &b);
+}
+
+mhCache::Entry *mhCache::refresh(const clap_host_t *host, const clap_context_menu_target &t)
+{
+    auto ext = mhGetExt(host);
+    if (!ext)
+        return nullptr;
+
+    Entry e;
+    mhPopulate(host, ext, t, e.items);
+    e.builtAtMs = juce::Time::getMillisecondCounterHiRes();
+
+    auto &res = entries[keyFor(host, t)];
+    res = std::move(e);
+    return &res;
+}
+
+// From the cache if it is on, otherwise straight from the host into scratch
+const std::vector<mhItem> &mhItemsFor(const clap_host_t *host, const clap_host_context_menu_t *ext,
+                                      const clap_context_menu_target &t,
+                                      std::vector<mhItem> &scratch)
+{
+    auto &cache = mhCache::get();
+    if (!cache.policy.enabled)
+    {
+        mhPopulate(host, ext, t, scratch);
+        return scratch;
+    }
+
+    auto key = mhCache::keyFor(host, t);
+    cache.pendingPrefetches.erase(key);
+    auto entry = cache.find(key);
+    if (!entry)
+        entry = cache.refresh(host, t);
+    return entry ? entry->items : scratch;
+}
+
+/*
+ * Keeps the entries of the first list which every other list has too, matched by
+ * kind, label, the submenus they sit in and how many times that repeats before them.
+ * A merged entry is enabled or checked only if it is in all the lists. Its action is
+ * its row in ids, which holds the action id from each list in turn.
+ */
+void mhMerge(const std::vector<const std::vector<mhItem> *> &lists, std::vector<mhItem> &merged,
+             std::vector<clap_id> &ids)
+{
+    auto keysFor = [](const std::vector<mhItem> &items, auto &&onEntry) {
+        std::string path;
+        std::vector<size_t> pathLengths;
+        std::unordered_map<std::string, uint32_t> seen;
+        for (auto &it : items)
+        {
+            switch (it.kind)
+            {
+            case CLAP_CONTEXT_MENU_ITEM_BEGIN_SUBMENU:
+                pathLengths.push_back(path.size());
+                path += it.label + '\x1f';
+                onEntry(std::string(), it);
+                break;
+            case CLAP_CONTEXT_MENU_ITEM_END_SUBMENU:
+                if (!pathLengths.empty())
+                {
+                    path.resize(pathLengths.back());
+                    pathLengths.pop_back();
+                }
+                onEntry(std::string(), it);
+                break;
+            case CLAP_CONTEXT_MENU_ITEM_ENTRY:
+            case CLAP_CONTEXT_MENU_ITEM_CHECK_ENTRY:
+            {
+                auto key = path + (char)('0' + it.kind) + it.label;
+                key += '#' + std::to_string(seen[key]++);
+                onEntry(key, it);
+            }
+            break;
+            default:
+                onEntry(std::string(), it);
+                break;
+            }
+        }
+    };
+
+    std::vector<std::unordered_map<std::string, const mhItem *>> others(lists.size() - 1);
+    for (size_t l = 1; l < lists.size(); ++l)
+        keysFor(*lists[l], [&](const std::string &key, const mhItem &it) {
+            if (!key.empty())
+                others[l - 1][key] = &it;
+        });
+
+    keysFor(*lists[0], [&](const std::string &key, const mhItem &it) {
+        if (key.empty())
+        {
+            merged.push_back(it);
+            return;
+        }
+
+        auto res = it;
+        res.actionId = (clap_id)(ids.size() / lists.size());
+        auto row = ids.size();
+        ids.push_back(it.actionId);
+        for (auto &o : others)
+        {
+            auto match = o.find(key);
+            if (match == o.end())
+            {
+                ids.resize(row);
+                return;
+            }
+            res.isEnabled = res.isEnabled && match->second->isEnabled;
+            res.isChecked = res.isChecked && match->second->isChecked;
+            ids.push_back(match->second->actionId);
+        }
+        merged.push_back(std::move(res));
+    });
+}
+
+void mhAppend(juce::PopupMenu &p, const std::vector<mhItem> &items,
+              const std::shared_ptr<const mhActions> &actions)
+{
+    mhMenuBuilder mb(p, actions);
+    for (auto &it : items)
+        mb.add(it.kind, it.label.c_str(), it.isEnabled, it.isChecked, it.actionId);
+}
+
+// From the cache if it is on, otherwise streamed from the host into the menu
+void mhAppendFor(juce::PopupMenu &p, const clap_host_t *host,
+                 const clap_host_context_menu_t *ext, const clap_context_menu_target &t)
+{
+    auto actions = std::make_shared<mhActions>();
+    actions->host = host;
+    actions->ext = ext;
+    actions->targets.push_back(t);
+
+    if (mhCache::get().policy.enabled)
+    {
+        std::vector<mhItem> scratch;
+        mhAppend(p, mhItemsFor(host, ext, t, scratch), actions);
+        return;
+    }
+
+    mhMenuBuilder mb(p, actions);
+    clap_context_menu_builder b;
+    b.ctx = &mb;
+    b.add_item = mhBuildItem;
+    b.supports = mhSupports;
+    ext->populate(host, &t, &b);
 }
 
 // If there's a host extension for menus, add a separator then the menus
@@ -146,23 +482,100 @@ void populateMenuForClapParam(juce::PopupMenu &p, clap_id paramId, const clap_ho
         return;
     }
 
-    auto chcm = static_cast<const clap_host_context_menu_t *>(ext);
+    mhAppendFor(p, host, ext, mhParamTarget(paramId));
+}
 
-    auto mhc = mhCtx(p);
-    mhc.host = host;
-    mhc.parId = paramId;
+void populateMenuForClapParams(juce::PopupMenu &p, const clap_id *paramIds, size_t count,
+                               bool includeGlobal, const clap_host_t *host)
+{
+    if (!host)
+        return;
 
-    clap_context_menu_target t;
-    t.kind = CLAP_CONTEXT_MENU_TARGET_KIND_PARAM;
-    t.id = paramId;
+    auto ext = mhGetExt(host);
+    if (!ext)
+        return;
 
-    clap_context_menu_builder b;
-    b.ctx = &mhc;
-    b.add_item = mhAddItem;
-    b.supports = mhSupports;
+    if (count == 1)
+    {
+        mhAppendFor(p, host, ext, mhParamTarget(paramIds[0]));
+    }
+    else if (count > 1)
+    {
+        auto actions = std::make_shared<mhActions>();
+        actions->host = host;
+        actions->ext = ext;
+
+        std::vector<std::vector<mhItem>> scratch(count);
+        std::vector<const std::vector<mhItem> *> lists;
+        for (size_t i = 0; i < count; ++i)
+        {
+            actions->targets.push_back(mhParamTarget(paramIds[i]));
+            lists.push_back(&mhItemsFor(host, ext, actions->targets.back(), scratch[i]));
+        }
 
-    chcm->populate(host, &t, &b);
+        std::vector<mhItem> merged;
+        mhMerge(lists, merged, actions->ids);
+        mhAppend(p, merged, actions);
+    }
+
+    if (includeGlobal)
+        mhAppendFor(p, host, ext, mhGlobalTarget());
+}
+
+void setClapMenuCachePolicy(const ClapMenuCachePolicy &p)
+{
+    auto &cache = mhCache::get();
+    cache.policy = p;
+    if (!p.enabled)
+    {
+        cache.entries.clear();
+        cache.pendingPrefetches.clear();
+    }
+}
+
+void mhPrefetch(const clap_host_t *host, const clap_context_menu_target &t)
+{
+    auto &cache = mhCache::get();
+    auto key = mhCache::keyFor(host, t);
+    if (cache.find(key) || !cache.pendingPrefetches.insert(key).second)
+        return;
+
+    // Dropped if the host was invalidated or a right click got there first
+    juce::MessageManager::callAsync([host, t, key]() {
+        auto &c = mhCache::get();
+        if (c.pendingPrefetches.erase(key) == 0 || c.find(key))
+            return;
+        c.refresh(host, t);
+    });
+}
+
+void prefetchMenuForClapParam(clap_id paramId, const clap_host_t *host)
+{
+    if (host && mhCache::get().policy.enabled)
+        mhPrefetch(host, mhParamTarget(paramId));
+}
+
+void prefetchMenuForClapParams(const clap_id *paramIds, size_t count, bool includeGlobal,
+                               const clap_host_t *host)
+{
+    if (!host || !mhCache::get().policy.enabled)
+        return;
+    for (size_t i = 0; i < count; ++i)
+        mhPrefetch(host, mhParamTarget(paramIds[i]));
+    if (includeGlobal)
+        mhPrefetch(host, mhGlobalTarget());
+}
+
+void invalidateClapMenuCache(clap_id paramId, const clap_host_t *host)
+{
+    auto &cache = mhCache::get();
+    auto key = mhCache::keyFor(host, mhParamTarget(paramId));
+    cache.entries.erase(key);
+    cache.pendingPrefetches.erase(key);
+}
 
-    return;
+void invalidateClapMenuCache(const clap_host_t *host)
+{
+    mhCache::get().eraseHost(host);
 }
-} // namespace sst::clap_juce_shim
\ No newline at end of file
+} // namespace sst::clap_juce_shim
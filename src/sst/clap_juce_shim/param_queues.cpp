@@ -0,0 +1,261 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "sst/clap_juce_shim/param_queues.h"
+
+namespace sst::clap_juce_shim
+{
+void AudioToGuiParamChannel::setParamIds(const std::vector<clap_id> &newIds)
+{
+    ids = newIds;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    slots = std::make_unique<Slot[]>(ids.size());
+    ringSize = (uint32_t)ids.size() + 1;
+    ring = std::make_unique<uint32_t[]>(ringSize);
+    writePos = 0;
+    readPos = 0;
+    batch.clear();
+    batch.reserve(ids.size());
+}
+
+const std::vector<AudioToGuiParamChannel::Update> &AudioToGuiParamChannel::drain() noexcept
+{
+    batch.clear();
+
+    auto r = readPos.load(std::memory_order_relaxed);
+    auto w = writePos.load(std::memory_order_acquire);
+    while (r != w)
+    {
+        auto idx = ring[r];
+        r = (r + 1 == ringSize) ? 0 : r + 1;
+
+        // Clear the flag before reading, so a value written after the read queues
+        // the slot again rather than being lost
+        auto &s = slots[idx];
+        s.queued.exchange(false, std::memory_order_acq_rel);
+        batch.push_back({ids[idx], s.value.load(std::memory_order_acquire)});
+    }
+    readPos.store(r, std::memory_order_release);
+
+    return batch;
+}
+
+void GuiToAudioParamQueue::setParamIds(const std::vector<clap_id> &newIds)
+{
+    ids = newIds;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    slots = std::make_unique<Slot[]>(ids.size());
+
+    // Room for every slot's value plus a healthy run of gestures between drains
+    size_t cap{64};
+    while (cap < ids.size() * 4)
+        cap *= 2;
+    cells = std::make_unique<Cell[]>(cap);
+    for (size_t i = 0; i < cap; ++i)
+        cells[i].seq.store(i, std::memory_order_relaxed);
+    mask = cap - 1;
+    enqueuePos = 0;
+    dequeuePos = 0;
+    batchRequested = false;
+}
+
+bool GuiToAudioParamQueue::postGesture(clap_id id, Event::Kind k) noexcept
+{
+    auto slot = slotFor(id);
+    if (slot < 0)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Seal any value still queued, so later values cannot coalesce into it
+    auto e = Event{k, (uint32_t)slot};
+    auto &s = slots[slot];
+    auto st = s.state.load(std::memory_order_acquire);
+    while ((st & 1) &&
+           !s.state.compare_exchange_weak(st, st + 1, std::memory_order_acq_rel))
+        ;
+    if (st & 1)
+    {
+        e.sealed = true;
+        e.value = s.value.load(std::memory_order_acquire);
+    }
+
+    if (!enqueue(e))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    requestCallbackOnce();
+    return true;
+}
+
+bool GuiToAudioParamQueue::postValue(clap_id id, double value) noexcept
+{
+    auto slot = slotFor(id);
+    if (slot < 0)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto &s = slots[slot];
+    s.value.store(value, std::memory_order_relaxed);
+    auto st = s.state.fetch_or(1, std::memory_order_acq_rel);
+    if (st & 1)
+        return true; // coalesced into the value already queued
+
+    if (!enqueue({Event::VALUE, (uint32_t)slot, st >> 1}))
+    {
+        // Unless a gesture sealed it meanwhile, in which case the value went with that
+        auto queued = st | 1;
+        s.state.compare_exchange_strong(queued, st, std::memory_order_acq_rel);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    requestCallbackOnce();
+    return true;
+}
+
+uint32_t GuiToAudioParamQueue::drain(const clap_output_events_t *out) noexcept
+{
+    // Anything posted from here on belongs to the next batch
+    batchRequested.store(false, std::memory_order_release);
+
+    uint32_t res{0};
+    auto pushValue = [&](clap_id pid, double value) {
+        auto ev = clap_event_param_value_t();
+        ev.header.size = sizeof(ev);
+        ev.header.time = 0;
+        ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+        ev.header.type = CLAP_EVENT_PARAM_VALUE;
+        ev.header.flags = 0;
+        ev.param_id = pid;
+        ev.cookie = nullptr;
+        ev.note_id = -1;
+        ev.port_index = -1;
+        ev.channel = -1;
+        ev.key = -1;
+        ev.value = value;
+        if (out->try_push(out, &ev.header))
+            res++;
+    };
+
+    Event e;
+    while (dequeue(e))
+    {
+        auto pid = ids[e.slot];
+        if (e.kind == Event::VALUE)
+        {
+            // Claim the value unless a gesture sealed it, which then carries it. Clear
+            // the flag before reading, so a value written after the read queues again.
+            auto &s = slots[e.slot];
+            auto queued = e.generation << 1 | 1;
+            if (s.state.compare_exchange_strong(queued, e.generation << 1,
+                                                std::memory_order_acq_rel))
+                pushValue(pid, s.value.load(std::memory_order_acquire));
+        }
+        else
+        {
+            if (e.sealed)
+                pushValue(pid, e.value);
+
+            auto ev = clap_event_param_gesture_t();
+            ev.header.size = sizeof(ev);
+            ev.header.time = 0;
+            ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            ev.header.type = e.kind == Event::BEGIN ? CLAP_EVENT_PARAM_GESTURE_BEGIN
+                                                    : CLAP_EVENT_PARAM_GESTURE_END;
+            ev.header.flags = 0;
+            ev.param_id = pid;
+            if (out->try_push(out, &ev.header))
+                res++;
+        }
+    }
+    return res;
+}
+
+void GuiToAudioParamQueue::requestCallbackOnce() noexcept
+{
+    if (host && !batchRequested.exchange(true, std::memory_order_acq_rel))
+        host->request_callback(host);
+}
+
+// A bounded multi producer queue in the style of Dmitry Vyukov's: each cell's
+// sequence number says whether it is free for the producer or ready for the consumer
+bool GuiToAudioParamQueue::enqueue(const Event &e) noexcept
+{
+    if (!cells)
+        return false;
+
+    auto pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell *cell{nullptr};
+    while (true)
+    {
+        cell = &cells[pos & mask];
+        auto seq = cell->seq.load(std::memory_order_acquire);
+        auto diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // full
+        }
+        else
+        {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->event = e;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool GuiToAudioParamQueue::dequeue(Event &e) noexcept
+{
+    if (!cells)
+        return false;
+
+    auto pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell *cell{nullptr};
+    while (true)
+    {
+        cell = &cells[pos & mask];
+        auto seq = cell->seq.load(std::memory_order_acquire);
+        auto diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // empty
+        }
+        else
+        {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    e = cell->event;
+    cell->seq.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+} // namespace sst::clap_juce_shim
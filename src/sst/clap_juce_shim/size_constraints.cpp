@@ -0,0 +1,72 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "sst/clap_juce_shim/clap_juce_shim.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sst::clap_juce_shim
+{
+void adjustSizeToConstraints(const EditorSizeConstraints &c, double scale, uint32_t &width,
+                             uint32_t &height) noexcept
+{
+    auto sc = (c.scaleWithGui && scale > 0) ? scale : 1.0;
+    auto w = std::max(width / sc, 1.0), h = std::max(height / sc, 1.0);
+
+    auto limit = [](double v, uint32_t lo, uint32_t hi) {
+        if (lo > 0)
+            v = std::max(v, (double)lo);
+        if (hi > 0)
+            v = std::min(v, (double)hi);
+        return v;
+    };
+    w = limit(w, c.minWidth, c.maxWidth);
+    h = limit(h, c.minHeight, c.maxHeight);
+
+    auto ar = c.aspectRatio;
+    if (ar > 0)
+    {
+        // Shrink whichever side overshoots the ratio, then pull back inside the limits
+        // keeping the ratio. If the limits and ratio disagree the maximums win.
+        if (w / h > ar)
+            w = h * ar;
+        else
+            h = w / ar;
+
+        if (c.minWidth > 0 && w < c.minWidth)
+            w = c.minWidth, h = w / ar;
+        if (c.minHeight > 0 && h < c.minHeight)
+            h = c.minHeight, w = h * ar;
+        if (c.maxWidth > 0 && w > c.maxWidth)
+            w = c.maxWidth, h = w / ar;
+        if (c.maxHeight > 0 && h > c.maxHeight)
+            h = c.maxHeight, w = h * ar;
+    }
+
+    auto snap = [](double v, uint32_t from, uint32_t step) {
+        if (step <= 1 || v <= from)
+            return std::round(v);
+        return from + std::floor((v - from) / step) * step;
+    };
+    w = snap(w, c.minWidth, c.widthStep);
+    if (ar > 0)
+        h = std::round(w / ar);
+    else
+        h = snap(h, c.minHeight, c.heightStep);
+
+    width = (uint32_t)std::max(std::round(w * sc), 1.0);
+    height = (uint32_t)std::max(std::round(h * sc), 1.0);
+}
+} // namespace sst::clap_juce_shim
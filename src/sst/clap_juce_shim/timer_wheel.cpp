@@ -0,0 +1,248 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "sst/clap_juce_shim/timer_wheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace sst::clap_juce_shim
+{
+uint64_t TimerWheel::nowTick()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+TimerWheel::Handle TimerWheel::schedule(double periodMs, Callback cb, double firstDelayMs)
+{
+    auto period = (uint64_t)std::max(std::llround(periodMs), 1LL);
+    auto first = firstDelayMs < 0 ? period : (uint64_t)std::max(std::llround(firstDelayMs), 1LL);
+    return add(period, first, true, std::move(cb));
+}
+
+TimerWheel::Handle TimerWheel::scheduleOnce(double delayMs, Callback cb)
+{
+    auto delay = (uint64_t)std::max(std::llround(delayMs), 1LL);
+    return add(delay, delay, false, std::move(cb));
+}
+
+void TimerWheel::cancel(Handle h)
+{
+    auto *e = lookup(h);
+    if (!e)
+        return;
+
+    e->live = false;
+    active--;
+    stats.cancelled++;
+
+    // A callback cancelling itself is still running, so free it once it returns
+    auto idx = (uint32_t)(h & 0xFFFFFFFF);
+    if ((int64_t)idx == firing)
+        releaseFiring = true;
+    else
+        release(idx);
+}
+
+void TimerWheel::cancelAll()
+{
+    for (uint32_t i = 0; i < entries.size(); ++i)
+        if (entries[i].live)
+            cancel(makeHandle(i, entries[i].generation));
+}
+
+uint32_t TimerWheel::advance()
+{
+    auto target = nowTick();
+    if (active == 0)
+    {
+        currentTick = std::max(currentTick, target);
+        return 0;
+    }
+
+    uint32_t fired{0};
+    while (currentTick < target)
+    {
+        // Skip whole revolutions of empty lower levels rather than walking every tick
+        auto next = currentTick + 1;
+        for (int l = 0; l < levels - 1 && levelCount[l] == 0; ++l)
+        {
+            auto span = 1ULL << (levelBits * (l + 1));
+            next = (currentTick / span + 1) * span;
+        }
+        currentTick = std::min(next, target);
+
+        for (int l = levels - 1; l > 0; --l)
+            if ((currentTick & ((1ULL << (levelBits * l)) - 1)) == 0)
+                cascade(l);
+
+        auto &slot = wheel[0][currentTick & slotMask];
+        if (slot.empty())
+            continue;
+        levelCount[0] -= slot.size();
+        firingSlot.swap(slot);
+
+        for (auto h : firingSlot)
+        {
+            auto *e = lookup(h);
+            if (!e)
+                continue;
+
+            auto idx = (uint32_t)(h & 0xFFFFFFFF);
+            firing = idx;
+            releaseFiring = false;
+            e->cb();
+            firing = -1;
+            stats.fired++;
+            fired++;
+
+            if (releaseFiring)
+            {
+                release(idx);
+            }
+            else if (!e->periodic)
+            {
+                e->live = false;
+                active--;
+                release(idx);
+            }
+            else
+            {
+                // Drop ticks missed while nobody advanced us rather than firing a burst.
+                // The catch up is against the target, not the tick we are walking, or
+                // a late timer would fire once per period on the way there.
+                e->due += ((target - e->due) / e->interval + 1) * e->interval;
+                insert(h, e->due);
+            }
+        }
+        firingSlot.clear();
+    }
+    return fired;
+}
+
+// Both scans are linear in the live timers, which is a few dozen at most
+double TimerWheel::millisecondsToNextDeadline() const
+{
+    if (active == 0)
+        return -1;
+
+    auto due = UINT64_MAX;
+    for (auto &e : entries)
+        if (e.live)
+            due = std::min(due, e.due);
+
+    auto now = nowTick();
+    return due > now ? (double)(due - now) : 0.0;
+}
+
+double TimerWheel::shortestIntervalMilliseconds() const
+{
+    if (active == 0)
+        return -1;
+
+    auto res = UINT64_MAX;
+    for (auto &e : entries)
+        if (e.live)
+            res = std::min(res, e.interval);
+    return (double)res;
+}
+
+TimerWheel::Entry *TimerWheel::lookup(Handle h)
+{
+    auto idx = (uint32_t)(h & 0xFFFFFFFF);
+    if (idx >= entries.size())
+        return nullptr;
+    auto &e = entries[idx];
+    if (!e.live || e.generation != (uint32_t)(h >> 32))
+        return nullptr;
+    return &e;
+}
+
+TimerWheel::Handle TimerWheel::add(uint64_t interval, uint64_t firstDelay, bool periodic,
+                                   Callback &&cb)
+{
+    uint32_t idx;
+    if (!freeList.empty())
+    {
+        idx = freeList.back();
+        freeList.pop_back();
+    }
+    else
+    {
+        idx = (uint32_t)entries.size();
+        entries.emplace_back();
+    }
+
+    auto &e = entries[idx];
+    // Stale handles to a reused entry no longer match, and zero is never handed out
+    e.generation = e.generation == UINT32_MAX ? 1 : e.generation + 1;
+    e.interval = interval;
+    e.periodic = periodic;
+    e.live = true;
+    e.cb = std::move(cb);
+    e.due = nowTick() + firstDelay;
+
+    auto h = makeHandle(idx, e.generation);
+    insert(h, e.due);
+    active++;
+    stats.scheduled++;
+    return h;
+}
+
+void TimerWheel::insert(Handle h, uint64_t due)
+{
+    // Only a cascade can land on the current tick, and it runs before the tick fires
+    due = std::max(due, currentTick);
+    auto delta = due - currentTick;
+
+    for (int l = 0; l < levels; ++l)
+    {
+        if (delta < (1ULL << (levelBits * (l + 1))))
+        {
+            wheel[l][(due >> (levelBits * l)) & slotMask].push_back(h);
+            levelCount[l]++;
+            return;
+        }
+    }
+
+    // Beyond the wheel; park in the top slot furthest away and re-place on cascade
+    auto top = levels - 1;
+    wheel[top][((currentTick >> (levelBits * top)) + slotMask) & slotMask].push_back(h);
+    levelCount[top]++;
+}
+
+void TimerWheel::release(uint32_t idx)
+{
+    entries[idx].cb = nullptr;
+    freeList.push_back(idx);
+}
+
+void TimerWheel::cascade(int level)
+{
+    auto &slot = wheel[level][(currentTick >> (levelBits * level)) & slotMask];
+    if (slot.empty())
+        return;
+
+    std::vector<Handle> moving;
+    moving.swap(slot);
+    levelCount[level] -= moving.size();
+    stats.cascades++;
+
+    for (auto h : moving)
+        if (auto *e = lookup(h))
+            insert(h, e->due);
+}
+} // namespace sst::clap_juce_shim
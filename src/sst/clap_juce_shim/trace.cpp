@@ -0,0 +1,253 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "sst/clap_juce_shim/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace sst::clap_juce_shim::trace
+{
+namespace details
+{
+std::atomic<bool> enabledFlag{false};
+
+struct Event
+{
+    double ts;
+    double dur;
+    const char *name;
+    const char *category;
+    Arg args[4];
+    char phase;
+};
+
+/*
+ * One writer, its own thread. The exporter reads behind it and throws away anything
+ * the writer may have lapped while it was copying.
+ */
+struct Ring
+{
+    static constexpr uint64_t capacity{8192}, mask{capacity - 1};
+    explicit Ring(uint32_t t) : tid(t), events(std::make_unique<Event[]>(capacity)) {}
+
+    void push(const Event &e) noexcept
+    {
+        auto w = writePos.load(std::memory_order_relaxed);
+        events[w & mask] = e;
+        writePos.store(w + 1, std::memory_order_release);
+    }
+
+    uint32_t tid;
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> writePos{0}, clearedPos{0};
+};
+
+struct Registry
+{
+    static constexpr size_t maxThreads{64};
+
+    static Registry &get()
+    {
+        static Registry r;
+        return r;
+    }
+
+    // Rings live as long as the process so an exited thread's events survive it
+    Ring *ringForThisThread() noexcept
+    {
+        thread_local Ring *ring{nullptr};
+        thread_local bool refused{false};
+        if (ring || refused)
+            return ring;
+
+        std::lock_guard<std::mutex> g(lock);
+        if (rings.size() >= maxThreads)
+        {
+            refused = true;
+            return nullptr;
+        }
+        rings.push_back(std::make_unique<Ring>((uint32_t)rings.size() + 1));
+        ring = rings.back().get();
+        return ring;
+    }
+
+    std::mutex lock;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::atomic<uint64_t> dropped{0};
+    const std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+};
+
+static void record(char phase, const char *name, const char *category, double ts, double dur,
+                   const Arg &a0, const Arg &a1, const Arg &a2, const Arg &a3) noexcept
+{
+    auto &reg = Registry::get();
+    auto *ring = reg.ringForThisThread();
+    if (!ring)
+    {
+        reg.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->push({ts, dur, name, category, {a0, a1, a2, a3}, phase});
+}
+
+static void appendEscaped(std::ostringstream &oss, const char *s)
+{
+    oss << '"';
+    for (; s && *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            oss << '\\' << *s;
+        else if ((unsigned char)*s < 0x20)
+            oss << ' ';
+        else
+            oss << *s;
+    }
+    oss << '"';
+}
+} // namespace details
+
+void setEnabled(bool b) noexcept { details::enabledFlag.store(b, std::memory_order_relaxed); }
+
+double nowMicroseconds() noexcept
+{
+    using namespace std::chrono;
+    auto d = steady_clock::now() - details::Registry::get().epoch;
+    return duration_cast<duration<double, std::micro>>(d).count();
+}
+
+void instant(const char *name, const char *category, Arg a0, Arg a1, Arg a2, Arg a3) noexcept
+{
+    if (enabled())
+        details::record('i', name, category, nowMicroseconds(), 0, a0, a1, a2, a3);
+}
+
+void begin(const char *name, const char *category, Arg a0, Arg a1) noexcept
+{
+    if (enabled())
+        details::record('B', name, category, nowMicroseconds(), 0, a0, a1, {}, {});
+}
+
+void end(const char *name, const char *category) noexcept
+{
+    if (enabled())
+        details::record('E', name, category, nowMicroseconds(), 0, {}, {}, {}, {});
+}
+
+void complete(const char *name, const char *category, double startUs, double durationUs, Arg a0,
+              Arg a1) noexcept
+{
+    if (enabled())
+        details::record('X', name, category, startUs, durationUs, a0, a1, {}, {});
+}
+
+void clear() noexcept
+{
+    auto &reg = details::Registry::get();
+    std::lock_guard<std::mutex> g(reg.lock);
+    for (auto &r : reg.rings)
+        r->clearedPos.store(r->writePos.load(std::memory_order_acquire));
+    reg.dropped = 0;
+}
+
+Stats getStats() noexcept
+{
+    auto &reg = details::Registry::get();
+    std::lock_guard<std::mutex> g(reg.lock);
+
+    Stats res;
+    res.threads = (uint32_t)reg.rings.size();
+    res.dropped = reg.dropped.load(std::memory_order_relaxed);
+    for (auto &r : reg.rings)
+    {
+        auto n = r->writePos.load(std::memory_order_acquire) - r->clearedPos.load();
+        res.recorded += n;
+        if (n > details::Ring::capacity)
+            res.overwritten += n - details::Ring::capacity;
+    }
+    return res;
+}
+
+std::string exportChromeJson()
+{
+    auto &reg = details::Registry::get();
+    std::lock_guard<std::mutex> g(reg.lock);
+
+    std::ostringstream oss;
+    oss.precision(15);
+    oss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first{true};
+    std::vector<details::Event> copy;
+    for (auto &r : reg.rings)
+    {
+        auto cap = details::Ring::capacity;
+        auto w = r->writePos.load(std::memory_order_acquire);
+        auto from = std::max(w > cap ? w - cap : 0, r->clearedPos.load());
+
+        copy.clear();
+        for (auto i = from; i < w; ++i)
+            copy.push_back(r->events[i & details::Ring::mask]);
+
+        // Whatever the writer reached while we copied, and the slot it may be writing
+        // right now, may have overwritten our oldest
+        auto after = r->writePos.load(std::memory_order_acquire);
+        auto skip =
+            after + 1 > cap + from ? std::min(after + 1 - cap - from, (uint64_t)copy.size()) : 0;
+
+        for (auto i = skip; i < copy.size(); ++i)
+        {
+            auto &e = copy[i];
+            oss << (first ? "" : ",") << "{\"name\":";
+            details::appendEscaped(oss, e.name);
+            oss << ",\"cat\":";
+            details::appendEscaped(oss, e.category);
+            oss << ",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts << ",\"pid\":1,\"tid\":"
+                << r->tid;
+            if (e.phase == 'X')
+                oss << ",\"dur\":" << e.dur;
+            if (e.phase == 'i')
+                oss << ",\"s\":\"t\"";
+            if (e.args[0].name)
+            {
+                oss << ",\"args\":{";
+                for (int a = 0; a < 4 && e.args[a].name; ++a)
+                {
+                    oss << (a ? "," : "");
+                    details::appendEscaped(oss, e.args[a].name);
+                    oss << ":" << e.args[a].value;
+                }
+                oss << "}";
+            }
+            oss << "}";
+            first = false;
+        }
+    }
+    oss << "]}";
+    return oss.str();
+}
+
+bool writeChromeJson(const std::string &path)
+{
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs.is_open())
+        return false;
+    ofs << exportChromeJson();
+    return ofs.good();
+}
+} // namespace sst::clap_juce_shim::trace
@@ -0,0 +1,88 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+#include "sst/clap_juce_shim/histogram.h"
+
+#include <cmath>
+
+using sst::clap_juce_shim::Histogram;
+
+// Buckets are an eighth of an octave wide, so a percentile may read that much high
+static bool near(double got, double want) { return got >= want && got <= want * 1.125 + 1e-9; }
+
+SHIM_TEST(histogramEmptyIsZero)
+{
+    Histogram h;
+    SHIM_CHECK(h.count() == 0);
+    SHIM_CHECK(h.mean() == 0);
+    SHIM_CHECK(h.percentile(50) == 0);
+}
+
+SHIM_TEST(histogramPercentilesWithinABucket)
+{
+    Histogram h;
+    for (int i = 1; i <= 1000; ++i)
+        h.record(i);
+
+    SHIM_CHECK(h.count() == 1000);
+    SHIM_CHECK(h.min() == 1);
+    SHIM_CHECK(h.max() == 1000);
+    SHIM_CHECK(std::abs(h.mean() - 500.5) < 1e-9);
+    SHIM_CHECK(near(h.percentile(50), 500));
+    SHIM_CHECK(near(h.percentile(90), 900));
+    SHIM_CHECK(near(h.percentile(99), 990));
+    SHIM_CHECK(h.percentile(100) == 1000);
+    SHIM_CHECK(near(h.percentile(0), 1));
+}
+
+SHIM_TEST(histogramClampsToSeenRange)
+{
+    Histogram h;
+    h.record(3.0);
+    h.record(3.0);
+    SHIM_CHECK(h.percentile(1) == 3.0);
+    SHIM_CHECK(h.percentile(99) == 3.0);
+}
+
+SHIM_TEST(histogramZeroAndNegativeShareTheBottomBucket)
+{
+    Histogram h;
+    h.record(0);
+    h.record(-5);
+    h.record(10);
+    SHIM_CHECK(h.min() == -5);
+    SHIM_CHECK(h.percentile(50) == 0);
+    SHIM_CHECK(h.percentile(100) == 10);
+}
+
+SHIM_TEST(histogramHugeValuesLandInTheTopBucket)
+{
+    Histogram h;
+    h.record(1e-12);
+    h.record(1e12);
+    SHIM_CHECK(h.percentile(100) > 1e9 && h.percentile(100) <= h.max());
+    SHIM_CHECK(h.percentile(50) > 0);
+}
+
+SHIM_TEST(histogramReset)
+{
+    Histogram h;
+    h.record(5);
+    h.reset();
+    SHIM_CHECK(h.count() == 0);
+    h.record(7);
+    SHIM_CHECK(h.min() == 7);
+    SHIM_CHECK(h.max() == 7);
+}
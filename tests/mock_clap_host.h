@@ -0,0 +1,305 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef TESTS_MOCK_CLAP_HOST_H
+#define TESTS_MOCK_CLAP_HOST_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <poll.h>
+
+#include "clap/clap.h"
+#include "clap/ext/timer-support.h"
+#include "clap/ext/posix-fd-support.h"
+
+#include <juce_gui_basics/juce_gui_basics.h>
+
+#include "sst/clap_juce_shim/clap_juce_shim.h"
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+namespace sst::clap_juce_shim::test
+{
+/*
+ * An in process host implementing the clap timer and posix fd extensions, enough to
+ * drive ClapJuceShim the way a linux host main loop would: poll the registered fds
+ * with a timeout to the next timer, then deliver onPosixFd and onTimer. Each loaded
+ * Instance is a plugin whose EditorProvider reaches the host only through the
+ * extension structs. Everything runs on the calling thread, and like the fd
+ * extension itself this is linux only.
+ */
+struct MockClapHost
+{
+    struct Counts
+    {
+        uint64_t timerRegistrations{0};
+        uint64_t timerUnregistrations{0};
+        uint64_t timerCallbacks{0};
+        uint64_t fdRegistrations{0};
+        uint64_t fdModifications{0};
+        uint64_t fdUnregistrations{0};
+        uint64_t fdCallbacks{0};
+    };
+
+    struct Instance : EditorProvider
+    {
+        Instance(MockClapHost &h) : owner(h)
+        {
+            host.host_data = this;
+            host.name = "mock host";
+            host.get_extension = &MockClapHost::getExtension;
+            host.request_callback = [](const clap_host_t *) {};
+            shim = std::make_unique<ClapJuceShim>(this);
+        }
+
+        ~Instance() override
+        {
+            shim.reset();
+            owner.forget(this);
+        }
+
+        std::unique_ptr<juce::Component> createEditor() override { return makeEditor(); }
+
+        bool registerOrUnregisterTimer(clap_id &id, int ms, bool reg) override
+        {
+            auto *ts = static_cast<const clap_host_timer_support_t *>(
+                host.get_extension(&host, CLAP_EXT_TIMER_SUPPORT));
+            if (!ts)
+                return false;
+            return reg ? ts->register_timer(&host, (uint32_t)ms, &id)
+                       : ts->unregister_timer(&host, id);
+        }
+
+        bool registerOrUnregisterPosixFd(int fd, clap_posix_fd_flags_t flags, bool reg) override
+        {
+            auto *fs = static_cast<const clap_host_posix_fd_support_t *>(
+                host.get_extension(&host, CLAP_EXT_POSIX_FD_SUPPORT));
+            if (!fs)
+                return false;
+            return reg ? fs->register_fd(&host, fd, flags) : fs->unregister_fd(&host, fd);
+        }
+
+        MockClapHost &owner;
+        clap_host_t host{};
+        std::function<std::unique_ptr<juce::Component>()> makeEditor{[]() {
+            auto res = std::make_unique<juce::Component>();
+            res->setSize(400, 300);
+            return res;
+        }};
+        std::unique_ptr<ClapJuceShim> shim;
+    };
+
+    struct Timer
+    {
+        Instance *owner;
+        clap_id id;
+        uint32_t periodMs;
+        double dueMs;
+    };
+    struct Fd
+    {
+        Instance *owner;
+        int fd;
+        clap_posix_fd_flags_t flags;
+    };
+
+    std::unique_ptr<Instance> load() { return std::make_unique<Instance>(*this); }
+
+    /*
+     * Runs the main loop for about ms milliseconds, or until done returns true. Fds
+     * and timers are snapshotted per iteration, since callbacks register and
+     * unregister them, and each is checked to still exist before it is delivered.
+     */
+    void runFor(double ms, const std::function<bool()> &done = nullptr)
+    {
+        auto end = nowMs() + ms;
+        while (nowMs() < end && !(done && done()))
+        {
+            auto next = end;
+            for (auto &t : timers)
+                next = std::min(next, t.dueMs);
+
+            auto pfds = std::vector<pollfd>();
+            for (auto &f : fds)
+            {
+                short ev{0};
+                if (f.flags & CLAP_POSIX_FD_READ)
+                    ev |= POLLIN;
+                if (f.flags & CLAP_POSIX_FD_WRITE)
+                    ev |= POLLOUT;
+                pfds.push_back({f.fd, ev, 0});
+            }
+            auto wait = std::max((int)std::ceil(next - nowMs()), 0);
+            ::poll(pfds.data(), pfds.size(), wait);
+
+            for (auto &p : pfds)
+            {
+                if (!p.revents)
+                    continue;
+                auto *f = findFd(p.fd);
+                if (!f)
+                    continue;
+
+                clap_posix_fd_flags_t fl{0};
+                if (p.revents & POLLIN)
+                    fl |= CLAP_POSIX_FD_READ;
+                if (p.revents & POLLOUT)
+                    fl |= CLAP_POSIX_FD_WRITE;
+                if (p.revents & (POLLERR | POLLHUP | POLLNVAL))
+                    fl |= CLAP_POSIX_FD_ERROR;
+                counts.fdCallbacks++;
+                auto start = nowMs();
+                f->owner->shim->onPosixFd(p.fd, fl & f->flags);
+                fdCallbackMilliseconds.record(nowMs() - start);
+            }
+
+            auto now = nowMs();
+            auto due = std::vector<clap_id>();
+            for (auto &t : timers)
+                if (t.dueMs <= now)
+                    due.push_back(t.id);
+            for (auto id : due)
+            {
+                auto *t = findTimer(id);
+                if (!t)
+                    continue;
+                t->dueMs = std::max(t->dueMs + t->periodMs, now);
+                counts.timerCallbacks++;
+                auto start = nowMs();
+                t->owner->shim->onTimer(id);
+                timerCallbackMilliseconds.record(nowMs() - start);
+            }
+        }
+    }
+
+    static double nowMs()
+    {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    size_t timersOf(const Instance *i) const
+    {
+        return std::count_if(timers.begin(), timers.end(),
+                             [i](auto &t) { return t.owner == i; });
+    }
+    size_t fdsOf(const Instance *i) const
+    {
+        return std::count_if(fds.begin(), fds.end(), [i](auto &f) { return f.owner == i; });
+    }
+
+    Counts counts;
+    // Wall clock time spent inside the plugin's callbacks
+    Histogram timerCallbackMilliseconds, fdCallbackMilliseconds;
+    std::vector<Timer> timers;
+    std::vector<Fd> fds;
+    // Registrations an instance left behind when it was unloaded
+    uint64_t leakedTimers{0}, leakedFds{0};
+
+  private:
+    clap_id nextTimerId{1};
+
+    static Instance *instanceOf(const clap_host_t *h)
+    {
+        return static_cast<Instance *>(h->host_data);
+    }
+
+    static const void *getExtension(const clap_host_t *, const char *id)
+    {
+        static const clap_host_timer_support_t timerSupport{
+            [](const clap_host_t *h, uint32_t periodMs, clap_id *timerId) {
+                auto *i = instanceOf(h);
+                auto &self = i->owner;
+                self.counts.timerRegistrations++;
+                *timerId = self.nextTimerId++;
+                self.timers.push_back({i, *timerId, periodMs, nowMs() + periodMs});
+                return true;
+            },
+            [](const clap_host_t *h, clap_id timerId) {
+                auto &self = instanceOf(h)->owner;
+                self.counts.timerUnregistrations++;
+                auto &t = self.timers;
+                auto sz = t.size();
+                t.erase(std::remove_if(t.begin(), t.end(),
+                                       [timerId](auto &x) { return x.id == timerId; }),
+                        t.end());
+                return t.size() != sz;
+            }};
+        static const clap_host_posix_fd_support_t fdSupport{
+            [](const clap_host_t *h, int fd, clap_posix_fd_flags_t flags) {
+                auto *i = instanceOf(h);
+                auto &self = i->owner;
+                self.counts.fdRegistrations++;
+                if (self.findFd(fd))
+                    return false; // clap says one registration per fd
+                self.fds.push_back({i, fd, flags});
+                return true;
+            },
+            [](const clap_host_t *h, int fd, clap_posix_fd_flags_t flags) {
+                auto &self = instanceOf(h)->owner;
+                self.counts.fdModifications++;
+                auto *f = self.findFd(fd);
+                if (f)
+                    f->flags = flags;
+                return f != nullptr;
+            },
+            [](const clap_host_t *h, int fd) {
+                auto &self = instanceOf(h)->owner;
+                self.counts.fdUnregistrations++;
+                auto &f = self.fds;
+                auto sz = f.size();
+                f.erase(std::remove_if(f.begin(), f.end(), [fd](auto &x) { return x.fd == fd; }),
+                        f.end());
+                return f.size() != sz;
+            }};
+
+        if (std::string_view(id) == CLAP_EXT_TIMER_SUPPORT)
+            return &timerSupport;
+        if (std::string_view(id) == CLAP_EXT_POSIX_FD_SUPPORT)
+            return &fdSupport;
+        return nullptr;
+    }
+
+    Fd *findFd(int fd)
+    {
+        auto it = std::find_if(fds.begin(), fds.end(), [fd](auto &f) { return f.fd == fd; });
+        return it == fds.end() ? nullptr : &*it;
+    }
+    Timer *findTimer(clap_id id)
+    {
+        auto it =
+            std::find_if(timers.begin(), timers.end(), [id](auto &t) { return t.id == id; });
+        return it == timers.end() ? nullptr : &*it;
+    }
+
+    void forget(const Instance *i)
+    {
+        leakedTimers += timersOf(i);
+        leakedFds += fdsOf(i);
+        timers.erase(std::remove_if(timers.begin(), timers.end(),
+                                    [i](auto &t) { return t.owner == i; }),
+                     timers.end());
+        fds.erase(std::remove_if(fds.begin(), fds.end(), [i](auto &f) { return f.owner == i; }),
+                  fds.end());
+    }
+};
+} // namespace sst::clap_juce_shim::test
+
+#endif // TESTS_MOCK_CLAP_HOST_H
@@ -0,0 +1,137 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+#include "mock_clap_host.h"
+
+#include <atomic>
+#include <thread>
+
+using sst::clap_juce_shim::ClapJuceShim;
+using sst::clap_juce_shim::test::MockClapHost;
+
+SHIM_TEST(mockHostFdsAreSharedBetweenInstancesAndMigrate)
+{
+    MockClapHost host;
+    const auto before = ClapJuceShim::getPosixFdStats();
+    auto hostRegistrations = [&before]() {
+        return ClapJuceShim::getPosixFdStats().hostRegistrations - before.hostRegistrations;
+    };
+    auto shimWakeups = [&before]() {
+        auto s = ClapJuceShim::getPosixFdStats();
+        return s.wakeups + s.staleWakeups - before.wakeups - before.staleWakeups;
+    };
+
+    auto a = host.load();
+    SHIM_REQUIRE(a->shim->guiCreate(CLAP_WINDOW_API_X11, false));
+    SHIM_REQUIRE(!host.fds.empty());
+    SHIM_CHECK(host.fdsOf(a.get()) == host.fds.size());
+    SHIM_CHECK(host.timersOf(a.get()) == 1);
+    SHIM_CHECK(hostRegistrations() == host.counts.fdRegistrations);
+
+    // Read and error only. Write interest on the x11 socket would have the host spin.
+    for (auto &f : host.fds)
+        SHIM_CHECK(f.flags == (CLAP_POSIX_FD_READ | CLAP_POSIX_FD_ERROR));
+
+    // An idle editor barely wakes the host
+    host.runFor(300);
+    auto idleWakeups = host.counts.fdCallbacks;
+    SHIM_CHECK(idleWakeups < 50);
+
+    // A message posted from another thread arrives through an fd, straight away
+    std::atomic<bool> ran{false};
+    std::thread([&ran]() { juce::MessageManager::callAsync([&ran]() { ran = true; }); }).join();
+    host.runFor(1000, [&ran]() { return ran.load(); });
+    SHIM_CHECK(ran);
+    SHIM_CHECK(host.counts.fdCallbacks > idleWakeups);
+
+    // A second editor gets its own timer but no second registration of the same fds
+    auto b = host.load();
+    auto fdRegistrations = host.counts.fdRegistrations;
+    SHIM_REQUIRE(b->shim->guiCreate(CLAP_WINDOW_API_X11, false));
+    SHIM_CHECK(host.counts.fdRegistrations == fdRegistrations);
+    SHIM_CHECK(host.fdsOf(b.get()) == 0);
+    SHIM_CHECK(host.timersOf(b.get()) == 1);
+    host.runFor(100);
+
+    // Closing the first editor hands its fds to the second
+    auto fdCount = host.fds.size();
+    a->shim->guiDestroy();
+    SHIM_CHECK(host.timersOf(a.get()) == 0);
+    SHIM_CHECK(host.fdsOf(a.get()) == 0);
+    SHIM_CHECK(host.fdsOf(b.get()) == fdCount);
+    host.runFor(100);
+
+    b->shim->guiDestroy();
+    SHIM_CHECK(host.fds.empty());
+    SHIM_CHECK(host.timers.empty());
+
+    a.reset();
+    b.reset();
+    SHIM_CHECK(host.leakedFds == 0);
+    SHIM_CHECK(host.leakedTimers == 0);
+
+    // Every host call and callback is accounted for by the shim's own counts
+    auto after = ClapJuceShim::getPosixFdStats();
+    SHIM_CHECK(hostRegistrations() == host.counts.fdRegistrations);
+    SHIM_CHECK(after.hostUnregistrations - before.hostUnregistrations ==
+               host.counts.fdUnregistrations);
+    SHIM_CHECK(host.counts.fdRegistrations == host.counts.fdUnregistrations);
+    SHIM_CHECK(host.counts.fdModifications == 0);
+    SHIM_CHECK(shimWakeups() == host.counts.fdCallbacks);
+}
+
+SHIM_TEST(mockHostIdleTimerSlowsDownWhenQuiet)
+{
+    MockClapHost host;
+    auto a = host.load();
+    auto rates = ClapJuceShim::IdleTimerRates();
+    rates.minHz = 10;
+    rates.maxHz = 100;
+    rates.quietMilliseconds = 100;
+    a->shim->setIdleTimerRates(rates);
+
+    SHIM_REQUIRE(a->shim->guiCreate(CLAP_WINDOW_API_X11, false));
+    SHIM_REQUIRE(host.timers.size() == 1);
+    SHIM_CHECK(host.timers[0].periodMs == 10);
+
+    auto slowed = [&host]() { return !host.timers.empty() && host.timers[0].periodMs == 100; };
+    host.runFor(1000, slowed);
+    SHIM_REQUIRE(host.timers.size() == 1);
+    SHIM_CHECK(host.timers[0].periodMs == 100);
+    SHIM_CHECK(a->shim->getIdleTimerHz() == 10);
+
+    a->shim->guiDestroy();
+    SHIM_CHECK(host.timers.empty());
+}
+
+SHIM_TEST(mockHostUnparentedEditorIsDestroyed)
+{
+    MockClapHost host;
+    auto a = host.load();
+    const auto live = ClapJuceShim::getLifecycleStats().liveEditors;
+
+    // Never parented, as without a display, and opened again after closing
+    for (int i = 0; i < 2; ++i)
+    {
+        SHIM_REQUIRE(a->shim->guiCreate(CLAP_WINDOW_API_X11, false));
+        SHIM_CHECK(ClapJuceShim::getLifecycleStats().liveEditors == live + 1);
+        host.runFor(50);
+
+        a->shim->guiDestroy();
+        SHIM_CHECK(ClapJuceShim::getLifecycleStats().liveEditors == live);
+        SHIM_CHECK(host.timers.empty());
+        SHIM_CHECK(host.fds.empty());
+    }
+}
@@ -0,0 +1,230 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+#include "sst/clap_juce_shim/param_queues.h"
+
+#include <vector>
+
+using sst::clap_juce_shim::AudioToGuiParamChannel;
+using sst::clap_juce_shim::GuiToAudioParamQueue;
+
+namespace
+{
+// Collects what a drain pushes, in the shape clap would hand it to the host
+struct Captured
+{
+    enum Kind
+    {
+        BEGIN,
+        END,
+        VALUE
+    } kind;
+    clap_id id;
+    double value;
+
+    bool operator==(const Captured &o) const
+    {
+        return kind == o.kind && id == o.id && (kind != VALUE || value == o.value);
+    }
+};
+
+struct OutputEvents
+{
+    std::vector<Captured> events;
+    clap_output_events_t out{};
+
+    OutputEvents()
+    {
+        out.ctx = this;
+        out.try_push = [](const clap_output_events_t *o, const clap_event_header_t *h) {
+            auto *self = static_cast<OutputEvents *>(o->ctx);
+            switch (h->type)
+            {
+            case CLAP_EVENT_PARAM_VALUE:
+            {
+                auto *v = reinterpret_cast<const clap_event_param_value_t *>(h);
+                self->events.push_back({Captured::VALUE, v->param_id, v->value});
+                break;
+            }
+            case CLAP_EVENT_PARAM_GESTURE_BEGIN:
+            case CLAP_EVENT_PARAM_GESTURE_END:
+            {
+                auto *g = reinterpret_cast<const clap_event_param_gesture_t *>(h);
+                auto begin = h->type == CLAP_EVENT_PARAM_GESTURE_BEGIN;
+                self->events.push_back({begin ? Captured::BEGIN : Captured::END, g->param_id, 0});
+                break;
+            }
+            default:
+                return false;
+            }
+            return true;
+        };
+    }
+};
+
+struct CallbackCountingHost
+{
+    int requests{0};
+    clap_host_t host{};
+
+    CallbackCountingHost()
+    {
+        host.host_data = this;
+        host.request_callback = [](const clap_host_t *h) {
+            static_cast<CallbackCountingHost *>(h->host_data)->requests++;
+        };
+    }
+};
+} // namespace
+
+SHIM_TEST(audioToGuiCoalescesPerId)
+{
+    AudioToGuiParamChannel ch;
+    ch.setParamIds({7, 3, 3, 11});
+    SHIM_CHECK(ch.size() == 3);
+
+    ch.push(3, 0.1);
+    ch.push(7, 0.5);
+    ch.push(3, 0.2);
+    ch.push(3, 0.3);
+
+    auto &b = ch.drain();
+    SHIM_REQUIRE(b.size() == 2);
+    SHIM_CHECK(b[0].id == 3 && b[0].value == 0.3);
+    SHIM_CHECK(b[1].id == 7 && b[1].value == 0.5);
+    SHIM_CHECK(ch.drain().empty());
+
+    ch.push(3, 0.4);
+    auto &again = ch.drain();
+    SHIM_REQUIRE(again.size() == 1);
+    SHIM_CHECK(again[0].value == 0.4);
+}
+
+SHIM_TEST(audioToGuiCountsUnknownIds)
+{
+    AudioToGuiParamChannel ch;
+    ch.setParamIds({1, 2});
+    SHIM_CHECK(!ch.push(5, 1.0));
+    SHIM_CHECK(ch.getUnknownIdCount() == 1);
+    SHIM_CHECK(ch.drain().empty());
+}
+
+SHIM_TEST(guiToAudioKeepsGestureOrderAndCoalescesValues)
+{
+    GuiToAudioParamQueue q;
+    q.setParamIds({1, 2});
+
+    q.postGestureBegin(1);
+    q.postValue(1, 0.1);
+    q.postValue(2, 0.7);
+    q.postValue(1, 0.2);
+    q.postValue(1, 0.3);
+
+    OutputEvents oe;
+    SHIM_CHECK(q.drain(&oe.out) == 3);
+    auto want = std::vector<Captured>{
+        {Captured::BEGIN, 1, 0}, {Captured::VALUE, 1, 0.3}, {Captured::VALUE, 2, 0.7}};
+    SHIM_CHECK(oe.events == want);
+
+    // The slot was drained, so a new value queues again
+    q.postValue(1, 0.4);
+    q.postGestureEnd(1);
+    oe.events.clear();
+    SHIM_CHECK(q.drain(&oe.out) == 2);
+    want = {{Captured::VALUE, 1, 0.4}, {Captured::END, 1, 0}};
+    SHIM_CHECK(oe.events == want);
+}
+
+SHIM_TEST(guiToAudioNeverCoalescesAcrossGestures)
+{
+    GuiToAudioParamQueue q;
+    q.setParamIds({1, 2});
+
+    q.postGestureBegin(1);
+    q.postValue(1, 0.1);
+    q.postValue(1, 0.2);
+    q.postGestureEnd(1);
+    q.postGestureBegin(1);
+    q.postValue(1, 0.9);
+    q.postGestureEnd(1);
+    q.postValue(1, 0.5);
+    q.postValue(2, 0.6); // another id's gestures do not seal this one
+    q.postGestureBegin(1);
+    q.postValue(2, 0.7);
+
+    OutputEvents oe;
+    SHIM_CHECK(q.drain(&oe.out) == 9);
+    auto want = std::vector<Captured>{
+        {Captured::BEGIN, 1, 0}, {Captured::VALUE, 1, 0.2}, {Captured::END, 1, 0},
+        {Captured::BEGIN, 1, 0}, {Captured::VALUE, 1, 0.9}, {Captured::END, 1, 0},
+        {Captured::VALUE, 2, 0.7}, {Captured::VALUE, 1, 0.5}, {Captured::BEGIN, 1, 0}};
+    SHIM_CHECK(oe.events == want);
+
+    // Sealed values do not linger into the next batch
+    oe.events.clear();
+    SHIM_CHECK(q.drain(&oe.out) == 0);
+    q.postValue(1, 0.3);
+    SHIM_CHECK(q.drain(&oe.out) == 1);
+    want = {{Captured::VALUE, 1, 0.3}};
+    SHIM_CHECK(oe.events == want);
+}
+
+SHIM_TEST(guiToAudioDropsUnknownIds)
+{
+    GuiToAudioParamQueue q;
+    q.setParamIds({1});
+    SHIM_CHECK(!q.postValue(9, 0.5));
+    SHIM_CHECK(!q.postGestureBegin(9));
+    SHIM_CHECK(q.getDroppedCount() == 2);
+
+    OutputEvents oe;
+    SHIM_CHECK(q.drain(&oe.out) == 0);
+}
+
+SHIM_TEST(guiToAudioRequestsOneCallbackPerBatch)
+{
+    CallbackCountingHost h;
+    GuiToAudioParamQueue q;
+    q.setParamIds({1, 2});
+    q.setHost(&h.host);
+
+    q.postGestureBegin(1);
+    q.postValue(1, 0.5);
+    q.postValue(2, 0.5);
+    q.postGestureEnd(1);
+    SHIM_CHECK(h.requests == 1);
+
+    OutputEvents oe;
+    q.drain(&oe.out);
+    q.postValue(1, 0.6);
+    SHIM_CHECK(h.requests == 2);
+}
+
+SHIM_TEST(guiToAudioDropsWhenFull)
+{
+    GuiToAudioParamQueue q;
+    q.setParamIds({1});
+
+    // One id gets the minimum of 64 cells
+    int accepted{0};
+    for (int i = 0; i < 100; ++i)
+        accepted += q.postGestureBegin(1) ? 1 : 0;
+    SHIM_CHECK(accepted == 64);
+    SHIM_CHECK(q.getDroppedCount() == 36);
+
+    OutputEvents oe;
+    SHIM_CHECK(q.drain(&oe.out) == 64);
+    SHIM_CHECK(q.postGestureEnd(1));
+}
@@ -0,0 +1,82 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+#include "sst/clap_juce_shim/clap_juce_shim.h"
+
+using sst::clap_juce_shim::adjustSizeToConstraints;
+using sst::clap_juce_shim::EditorSizeConstraints;
+
+static bool adjusted(const EditorSizeConstraints &c, double scale, uint32_t w, uint32_t h,
+                     uint32_t wantW, uint32_t wantH)
+{
+    adjustSizeToConstraints(c, scale, w, h);
+    if (w == wantW && h == wantH)
+        return true;
+    std::fprintf(stderr, "  got %ux%u, wanted %ux%u\n", w, h, wantW, wantH);
+    return false;
+}
+
+SHIM_TEST(sizeConstraintsUnconstrainedPassesThrough)
+{
+    auto c = EditorSizeConstraints();
+    SHIM_CHECK(adjusted(c, 1.0, 123, 456, 123, 456));
+    SHIM_CHECK(adjusted(c, 1.0, 0, 0, 1, 1));
+}
+
+SHIM_TEST(sizeConstraintsClampToLimits)
+{
+    auto c = EditorSizeConstraints();
+    c.minWidth = 100;
+    c.minHeight = 100;
+    c.maxWidth = 1000;
+    c.maxHeight = 800;
+    SHIM_CHECK(adjusted(c, 1.0, 50, 2000, 100, 800));
+    SHIM_CHECK(adjusted(c, 1.0, 500, 500, 500, 500));
+}
+
+SHIM_TEST(sizeConstraintsKeepAspectRatio)
+{
+    auto c = EditorSizeConstraints();
+    c.aspectRatio = 2.0;
+    SHIM_CHECK(adjusted(c, 1.0, 400, 400, 400, 200));
+    SHIM_CHECK(adjusted(c, 1.0, 1000, 100, 200, 100));
+
+    // The ratio is pulled back inside the limits, maximums winning
+    c.maxWidth = 300;
+    SHIM_CHECK(adjusted(c, 1.0, 1000, 1000, 300, 150));
+}
+
+SHIM_TEST(sizeConstraintsSnapToSteps)
+{
+    auto c = EditorSizeConstraints();
+    c.minWidth = 100;
+    c.minHeight = 50;
+    c.widthStep = 10;
+    c.heightStep = 25;
+    SHIM_CHECK(adjusted(c, 1.0, 157, 120, 150, 100));
+    SHIM_CHECK(adjusted(c, 1.0, 20, 20, 100, 50));
+}
+
+SHIM_TEST(sizeConstraintsScaleWithGui)
+{
+    auto c = EditorSizeConstraints();
+    c.minWidth = 100;
+    c.minHeight = 100;
+    SHIM_CHECK(adjusted(c, 2.0, 100, 100, 200, 200));
+    SHIM_CHECK(adjusted(c, 2.0, 500, 300, 500, 300));
+
+    c.scaleWithGui = false;
+    SHIM_CHECK(adjusted(c, 2.0, 100, 100, 100, 100));
+}
@@ -0,0 +1,111 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#ifndef TESTS_TEST_HARNESS_H
+#define TESTS_TEST_HARNESS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static_assert(__cplusplus >= 202002L, "Surge team libraries have moved to C++ 20");
+
+/*
+ * Just enough of a test runner to keep the library free of a test framework
+ * dependency. SHIM_TEST registers a case, SHIM_CHECK records a failure and carries
+ * on, SHIM_REQUIRE abandons the case.
+ */
+namespace sst::clap_juce_shim::test
+{
+struct Case
+{
+    const char *name;
+    void (*fn)();
+};
+
+inline std::vector<Case> &cases()
+{
+    static std::vector<Case> res;
+    return res;
+}
+
+inline int &failures()
+{
+    static int res{0};
+    return res;
+}
+
+struct Registrar
+{
+    Registrar(const char *name, void (*fn)()) { cases().push_back({name, fn}); }
+};
+
+struct Abandon
+{
+};
+
+inline void fail(const char *file, int line, const char *what)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures()++;
+}
+
+// Runs the cases whose name starts with filter, or all of them, and returns the exit code
+inline int runAll(const char *filter)
+{
+    int ran{0};
+    for (auto &c : cases())
+    {
+        if (filter && !std::string(c.name).starts_with(filter))
+            continue;
+
+        auto before = failures();
+        try
+        {
+            c.fn();
+        }
+        catch (const Abandon &)
+        {
+        }
+        ran++;
+        std::printf("%-48s %s\n", c.name, failures() == before ? "ok" : "FAILED");
+    }
+    std::printf("%d cases, %d failed checks\n", ran, failures());
+    return failures() == 0 && ran > 0 ? 0 : 1;
+}
+} // namespace sst::clap_juce_shim::test
+
+#define SHIM_TEST(name)                                                                            \
+    static void name();                                                                            \
+    static ::sst::clap_juce_shim::test::Registrar name##Registrar(#name, name);                    \
+    static void name()
+
+#define SHIM_CHECK(cond)                                                                           \
+    do                                                                                             \
+    {                                                                                              \
+        if (!(cond))                                                                               \
+            ::sst::clap_juce_shim::test::fail(__FILE__, __LINE__, #cond);                          \
+    } while (0)
+
+#define SHIM_REQUIRE(cond)                                                                         \
+    do                                                                                             \
+    {                                                                                              \
+        if (!(cond))                                                                               \
+        {                                                                                          \
+            ::sst::clap_juce_shim::test::fail(__FILE__, __LINE__, #cond);                          \
+            throw ::sst::clap_juce_shim::test::Abandon();                                          \
+        }                                                                                          \
+    } while (0)
+
+#endif // TESTS_TEST_HARNESS_H
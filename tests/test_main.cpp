@@ -0,0 +1,21 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+
+// An optional argument runs only the cases whose name starts with it
+int main(int argc, char **argv)
+{
+    return sst::clap_juce_shim::test::runAll(argc > 1 ? argv[1] : nullptr);
+}
@@ -0,0 +1,157 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+#include "sst/clap_juce_shim/timer_wheel.h"
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+using sst::clap_juce_shim::TimerWheel;
+
+// Advances the wheel until done says so or the deadline passes. Wall clock driven,
+// so limits are generous.
+static bool advanceUntil(TimerWheel &w, const std::function<bool()> &done, int timeoutMs = 2000)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!done())
+    {
+        if (std::chrono::steady_clock::now() > end)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        w.advance();
+    }
+    return true;
+}
+
+SHIM_TEST(timerWheelOneShotFiresOnce)
+{
+    TimerWheel w;
+    int n{0};
+    w.scheduleOnce(5, [&n]() { n++; });
+    SHIM_CHECK(!w.empty());
+    SHIM_REQUIRE(advanceUntil(w, [&n]() { return n > 0; }));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    w.advance();
+    SHIM_CHECK(n == 1);
+    SHIM_CHECK(w.empty());
+    SHIM_CHECK(w.getStats().fired == 1);
+}
+
+SHIM_TEST(timerWheelPeriodicRepeatsUntilCancelled)
+{
+    TimerWheel w;
+    int n{0};
+    auto h = w.schedule(2, [&n]() { n++; });
+    SHIM_REQUIRE(advanceUntil(w, [&n]() { return n >= 5; }));
+
+    w.cancel(h);
+    auto seen = n;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    w.advance();
+    SHIM_CHECK(n == seen);
+    SHIM_CHECK(w.empty());
+    SHIM_CHECK(w.getStats().cancelled == 1);
+}
+
+SHIM_TEST(timerWheelLatePeriodicFiresOnceNotABurst)
+{
+    TimerWheel w;
+    int n{0};
+    w.schedule(5, [&n]() { n++; });
+    w.advance();
+
+    // A dozen periods pass with nobody advancing the wheel
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    SHIM_CHECK(w.advance() == 1);
+    SHIM_CHECK(n == 1);
+
+    // and it carries on from now rather than from where it fell behind
+    SHIM_CHECK(w.millisecondsToNextDeadline() > 0);
+    SHIM_CHECK(w.millisecondsToNextDeadline() <= 5);
+}
+
+SHIM_TEST(timerWheelCallbackMayCancelItself)
+{
+    TimerWheel w;
+    int n{0};
+    TimerWheel::Handle h{0};
+    h = w.schedule(1, [&]() {
+        if (++n == 3)
+            w.cancel(h);
+    });
+    SHIM_REQUIRE(advanceUntil(w, [&w]() { return w.empty(); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    w.advance();
+    SHIM_CHECK(n == 3);
+}
+
+SHIM_TEST(timerWheelCallbackMayScheduleMore)
+{
+    TimerWheel w;
+    int inner{0};
+    w.scheduleOnce(1, [&]() { w.scheduleOnce(1, [&inner]() { inner++; }); });
+    SHIM_REQUIRE(advanceUntil(w, [&inner]() { return inner == 1; }));
+    SHIM_CHECK(w.empty());
+    SHIM_CHECK(w.getStats().scheduled == 2);
+}
+
+SHIM_TEST(timerWheelStaleHandleDoesNotCancelReusedEntry)
+{
+    TimerWheel w;
+    auto first = w.scheduleOnce(1000, []() {});
+    w.cancel(first);
+
+    int n{0};
+    auto second = w.scheduleOnce(1, [&n]() { n++; });
+    SHIM_CHECK(first != second);
+    w.cancel(first);
+    SHIM_CHECK(!w.empty());
+    SHIM_REQUIRE(advanceUntil(w, [&n]() { return n == 1; }));
+}
+
+SHIM_TEST(timerWheelLongDelayCascades)
+{
+    // Past the 64 tick first level, so it has to come down a level before firing
+    TimerWheel w;
+    bool fired{false};
+    auto start = std::chrono::steady_clock::now();
+    w.scheduleOnce(100, [&fired]() { fired = true; });
+    SHIM_REQUIRE(advanceUntil(w, [&fired]() { return fired; }));
+
+    auto took = std::chrono::steady_clock::now() - start;
+    SHIM_CHECK(took >= std::chrono::milliseconds(99));
+    SHIM_CHECK(w.getStats().cascades > 0);
+}
+
+SHIM_TEST(timerWheelDeadlinesAndIntervals)
+{
+    TimerWheel w;
+    SHIM_CHECK(w.millisecondsToNextDeadline() < 0);
+    SHIM_CHECK(w.shortestIntervalMilliseconds() < 0);
+
+    w.schedule(50, []() {});
+    auto h = w.scheduleOnce(20, []() {});
+    SHIM_CHECK(w.shortestIntervalMilliseconds() == 20);
+    SHIM_CHECK(w.millisecondsToNextDeadline() <= 20);
+
+    w.cancel(h);
+    SHIM_CHECK(w.shortestIntervalMilliseconds() == 50);
+
+    w.cancelAll();
+    SHIM_CHECK(w.empty());
+    SHIM_CHECK(w.millisecondsToNextDeadline() < 0);
+}
@@ -0,0 +1,147 @@
+/*
+ * sst-clap_helpers - an open source library of stuff which makes
+ * making clap easier for the Surge Synth Team.
+ *
+ * Copyright 2023-2025, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * sst-clap-helpers is released under the MIT license, as described
+ * by "LICENSE.md" in this repository.
+ *
+ * All source in sst-jucegui available at
+ * https://github.com/surge-synthesizer/sst-clap-helpers
+ */
+
+#include "test_harness.h"
+#include "sst/clap_juce_shim/trace.h"
+
+#include <string>
+#include <thread>
+
+namespace trace = sst::clap_juce_shim::trace;
+
+static size_t occurrences(const std::string &s, const std::string &what)
+{
+    size_t n{0};
+    for (auto p = s.find(what); p != std::string::npos; p = s.find(what, p + 1))
+        n++;
+    return n;
+}
+
+// Tracing is process wide, so each case starts from a cleared, known state
+struct TraceOn
+{
+    TraceOn()
+    {
+        trace::setEnabled(true);
+        trace::clear();
+    }
+    ~TraceOn()
+    {
+        trace::setEnabled(false);
+        trace::clear();
+    }
+};
+
+SHIM_TEST(traceDisabledRecordsNothing)
+{
+    trace::setEnabled(false);
+    trace::clear();
+    trace::instant("quiet", "test");
+    {
+        trace::Scope s("quietScope", "test");
+    }
+    SHIM_CHECK(trace::getStats().recorded == 0);
+    SHIM_CHECK(trace::exportChromeJson().find("quiet") == std::string::npos);
+}
+
+SHIM_TEST(traceScopeRecordsACompleteEvent)
+{
+    TraceOn on;
+    {
+        trace::Scope s("scoped", "test", {"w", 640}, {"h", 480});
+    }
+    auto json = trace::exportChromeJson();
+    SHIM_CHECK(trace::getStats().recorded == 1);
+    SHIM_CHECK(json.find("\"name\":\"scoped\"") != std::string::npos);
+    SHIM_CHECK(json.find("\"ph\":\"X\"") != std::string::npos);
+    SHIM_CHECK(json.find("\"dur\":") != std::string::npos);
+    SHIM_CHECK(json.find("\"args\":{\"w\":640,\"h\":480}") != std::string::npos);
+}
+
+SHIM_TEST(traceScopeStartedWhileDisabledStaysSilent)
+{
+    trace::setEnabled(false);
+    trace::clear();
+    {
+        trace::Scope s("late", "test");
+        trace::setEnabled(true);
+    }
+    SHIM_CHECK(trace::getStats().recorded == 0);
+    trace::setEnabled(false);
+}
+
+SHIM_TEST(traceEscapesNames)
+{
+    TraceOn on;
+    trace::instant("say \"hi\"\\", "test");
+    auto json = trace::exportChromeJson();
+    SHIM_CHECK(json.find("say \\\"hi\\\"\\\\") != std::string::npos);
+    SHIM_CHECK(json.find("\"s\":\"t\"") != std::string::npos);
+}
+
+SHIM_TEST(traceClearDropsEverything)
+{
+    TraceOn on;
+    trace::begin("a", "test");
+    trace::end("a", "test");
+    SHIM_CHECK(trace::getStats().recorded == 2);
+    trace::clear();
+    SHIM_CHECK(trace::getStats().recorded == 0);
+    SHIM_CHECK(occurrences(trace::exportChromeJson(), "\"name\"") == 0);
+}
+
+SHIM_TEST(traceRingKeepsTheNewestEvents)
+{
+    TraceOn on;
+    const int n{10000}; // more than the 8192 event ring
+    for (int i = 0; i < n; ++i)
+        trace::instant("fill", "test", {"i", i});
+
+    auto st = trace::getStats();
+    SHIM_CHECK(st.recorded == (uint64_t)n);
+    SHIM_CHECK(st.overwritten == (uint64_t)n - 8192);
+
+    // The oldest slot is the next one written, so the export leaves it out
+    auto json = trace::exportChromeJson();
+    SHIM_CHECK(occurrences(json, "\"name\":\"fill\"") == 8191);
+    SHIM_CHECK(json.find("\"i\":9999}") != std::string::npos);
+    SHIM_CHECK(json.find("\"i\":1809}") != std::string::npos);
+    SHIM_CHECK(json.find("\"i\":1808}") == std::string::npos);
+}
+
+SHIM_TEST(traceRingBelowCapacityExportsEverything)
+{
+    TraceOn on;
+    for (int i = 0; i < 8191; ++i)
+        trace::instant("fill", "test", {"i", i});
+    auto json = trace::exportChromeJson();
+    SHIM_CHECK(occurrences(json, "\"name\":\"fill\"") == 8191);
+    SHIM_CHECK(json.find("\"i\":0}") != std::string::npos);
+}
+
+SHIM_TEST(traceEachThreadGetsItsOwnRing)
+{
+    TraceOn on;
+    trace::instant("mine", "test");
+    auto before = trace::getStats().threads;
+    std::thread t([]() { trace::instant("other", "test"); });
+    t.join();
+
+    auto st = trace::getStats();
+    SHIM_CHECK(st.threads == before + 1);
+    SHIM_CHECK(st.recorded == 2);
+    auto json = trace::exportChromeJson();
+    SHIM_CHECK(json.find("\"other\"") != std::string::npos);
+    SHIM_CHECK(json.find("\"mine\"") != std::string::npos);
+}